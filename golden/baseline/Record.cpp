@@ -0,0 +1,160 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include "Cell1D.hpp"
+#include "Cell2D.hpp"
+
+// make golden-baseline, builds this against the sources of the baseline commit and writes the references of the solver
+// from before the thread pool, the ghost cells and the transports, to golden/baseline/, so src/Golden.cpp can show how far the solver moved
+// Only the scenarios the baseline can run: closed, Flux, no rain (it rains with std::rand), the setup is the same as Run1D and Run2D in src/Golden.cpp
+// The files are the same text as Save in src/Golden.cpp writes
+// The one change put in here is the ghost cells: the baseline never updates its border, so before each step the border
+// is filled the way BoundaryPolicy::Closed does it now, with that the fields of the current solver match these bit for bit
+// Without the fill 1d-closed differs in 78 of 128 cells (terrain by up to 1.2 next to the border) and 2d-closed in 1659 of 9216
+
+// Only Cell2D::DrawImage of the baseline needs it, and thats never called, so MLX42 doesn't have to be built
+extern "C" void mlx_put_pixel(mlx_image_t* image, uint32_t x, uint32_t y, uint32_t color) { }
+
+static SimulationVariables GetVariables()
+{
+	SimulationVariables Variables;
+	Variables.DT /= 2;
+	Variables.RAINFALL = 0;
+	Variables.EVAPORATION = 0;
+	return Variables;
+}
+
+// The ghost copies the inside cell next to it, terrain, water and sediment, like BoundaryPolicy::Closed
+template <typename T>
+static void CopyGhost(T& Ghost, const T& Inside)
+{
+	Ghost.TerrainHeight = Inside.TerrainHeight;
+	Ghost.WaterHeight = Inside.WaterHeight;
+	Ghost.Sediment = Inside.Sediment;
+}
+
+static void FillGhosts(Cell1D* Ptr, int Size)
+{
+	CopyGhost(Ptr[0], Ptr[1]);
+	CopyGhost(Ptr[Size - 1], Ptr[Size - 2]);
+}
+
+// The corners take the row next to them with x clamped inside
+static void FillGhosts(Cell2D* Ptr, int SizeX, int SizeY)
+{
+	for (int y = 1; y < SizeY - 1; y++)
+	{
+		CopyGhost(Ptr[y * SizeX], Ptr[1 + y * SizeX]);
+		CopyGhost(Ptr[SizeX - 1 + y * SizeX], Ptr[SizeX - 2 + y * SizeX]);
+	}
+	for (int x = 0; x < SizeX; x++)
+	{
+		int Inside = std::min(std::max(x, 1), SizeX - 2);
+		CopyGhost(Ptr[x], Ptr[Inside + SizeX]);
+		CopyGhost(Ptr[x + (SizeY - 1) * SizeX], Ptr[Inside + (SizeY - 2) * SizeX]);
+	}
+}
+
+static bool Save(const std::string& Path, int SizeX, int SizeY, int Steps, const std::vector<std::vector<float>>& Fields)
+{
+	std::FILE* File = std::fopen(Path.c_str(), "w");
+	if (!File)
+		return false;
+	std::fprintf(File, "golden %d %d %d %d\n", SizeX, SizeY, Steps, (int)Fields.size());
+	for (const std::vector<float>& Field : Fields)
+		for (size_t i = 0; i < Field.size(); i++)
+			std::fprintf(File, "%.9g%c", Field[i], (i + 1) % SizeX == 0 ? '\n' : ' ');
+	return std::fclose(File) == 0;
+}
+
+static bool Record1D(const std::string& Directory)
+{
+	SimulationVariables Variables = GetVariables();
+	int Size = 128;
+	int Steps = 2000;
+	std::vector<Cell1D> Cells(Size);
+
+	for (int i = 0; i < Size; i++)
+	{
+		int Offset = std::abs(i - Size / 2);
+		Cells[i].TerrainHeight = Offset * Offset * Variables.PIPE_LENGTH / (Size * Size / 4) * 32;
+	}
+	Cells[Size / 2].TerrainHeight += Variables.PIPE_LENGTH * 8;
+	Cells[Size / 2 - 1].TerrainHeight += Variables.PIPE_LENGTH * 9;
+	Cells[Size / 2 - 2].TerrainHeight += Variables.PIPE_LENGTH * 10;
+	Cells[Size - 2].WaterHeight = Variables.PIPE_LENGTH * 96;
+
+	for (int i = 0; i < Steps; i++)
+	{
+		FillGhosts(Cells.data(), Size);
+		Cell1D::UpdateCells(Variables, Cells.data(), Size);
+	}
+
+	std::vector<std::vector<float>> Fields(4);
+	for (int i = 0; i < Size; i++)
+	{
+		Fields[0].push_back(Cells[i].TerrainHeight);
+		Fields[1].push_back(Cells[i].WaterHeight);
+		Fields[2].push_back(Cells[i].Sediment);
+		Fields[3].push_back(Cells[i].Velocity);
+	}
+	return Save(Directory + "/1d-closed.golden", Size, 1, Steps, Fields);
+}
+
+static bool Record2D(const std::string& Directory, const char* Name, int Size, int Steps, float Ripples)
+{
+	SimulationVariables Variables = GetVariables();
+	int SizeX = Size;
+	int SizeY = Size;
+	std::vector<Cell2D> Cells(SizeX * SizeY);
+
+	for (int y = 0; y < SizeY; y++)
+		for (int x = 0; x < SizeX; x++)
+		{
+			Cell2D& Curr = Cells[x + y * SizeX];
+			float OX = x - SizeX / 2.0f;
+			float OY = y - SizeY / 2.0f;
+			Curr.TerrainHeight = (OX * OX + OY * OY) / SizeX * Variables.PIPE_LENGTH / 2 + Variables.PIPE_LENGTH * Ripples * std::sin(x * 0.7f) * std::cos(y * 0.45f);
+			if (x < SizeX / 3 && y < SizeY / 3)
+				Curr.WaterHeight = Variables.PIPE_LENGTH * 4;
+		}
+
+	for (int i = 0; i < Steps; i++)
+	{
+		FillGhosts(Cells.data(), SizeX, SizeY);
+		Cell2D::UpdateCells(Variables, Cells.data(), SizeX, SizeY);
+	}
+
+	std::vector<std::vector<float>> Fields(5);
+	for (size_t i = 0; i < Cells.size(); i++)
+	{
+		Fields[0].push_back(Cells[i].TerrainHeight);
+		Fields[1].push_back(Cells[i].WaterHeight);
+		Fields[2].push_back(Cells[i].Sediment);
+		Fields[3].push_back(Cells[i].Velocity.first);
+		Fields[4].push_back(Cells[i].Velocity.second);
+	}
+	return Save(Directory + "/" + Name + ".golden", SizeX, SizeY, Steps, Fields);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <dir>" << std::endl;
+		return 1;
+	}
+
+	int Failed = 0;
+	Failed += !Record1D(argv[1]);
+	Failed += !Record2D(argv[1], "2d-closed", 96, 300, 1);
+	Failed += !Record2D(argv[1], "2d-closed-steep", 64, 200, 3);
+	if (Failed)
+		std::cerr << "Can't write to " << argv[1] << std::endl;
+	return Failed != 0;
+}
@@ -0,0 +1,56 @@
+#include "Allocations.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> AllocationCount(0);
+
+size_t GetAllocationCount()
+{
+	return AllocationCount.load(std::memory_order_relaxed);
+}
+
+// The nothrow and array versions of the standard library end up here, the aligned ones have their own pair and aren't counted
+void* operator new(std::size_t Size)
+{
+	AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (Size == 0)
+		Size = 1;
+
+	while (true)
+	{
+		void* Ptr = std::malloc(Size);
+		if (Ptr)
+			return Ptr;
+
+		std::new_handler Handler = std::get_new_handler();
+		if (!Handler)
+			throw std::bad_alloc();
+		Handler();
+	}
+}
+
+void* operator new[](std::size_t Size)
+{
+	return operator new(Size);
+}
+
+void operator delete(void* Ptr) noexcept
+{
+	std::free(Ptr);
+}
+
+void operator delete[](void* Ptr) noexcept
+{
+	std::free(Ptr);
+}
+
+void operator delete(void* Ptr, std::size_t) noexcept
+{
+	std::free(Ptr);
+}
+
+void operator delete[](void* Ptr, std::size_t) noexcept
+{
+	std::free(Ptr);
+}
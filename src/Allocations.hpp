@@ -0,0 +1,10 @@
+#ifndef ALLOCATIONS_HPP
+#define ALLOCATIONS_HPP
+
+#include <cstddef>
+
+// Allocations.cpp replaces the global operator new with one that counts, so the bench and the golden check can see if a step allocates
+// Its only linked into WaterTest and WaterGolden, a library has no business replacing the operator new of whoever loads it
+size_t GetAllocationCount();
+
+#endif
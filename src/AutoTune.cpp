@@ -0,0 +1,129 @@
+#include "AutoTune.hpp"
+#include "World2D.hpp"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+static const double MIN_SECONDS = 0.15;	// per candidate, after the warmup
+static const int WARMUP_STEPS = 3;
+
+std::string GetCPUName()
+{
+	std::string Model = "unknown";
+	std::ifstream File("/proc/cpuinfo");
+	std::string Line;
+	while (std::getline(File, Line))
+		if (Line.compare(0, 10, "model name") == 0 && Line.find(':') != std::string::npos)
+		{
+			Model = Line.substr(Line.find(':') + 1);
+			Model.erase(0, Model.find_first_not_of(' '));
+			break;
+		}
+
+	return Model + " x" + std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+static const char* GetTransportKey(const SimulationVariables& Variables)
+{
+	return Variables.Transport == SedimentTransport::Flux ? "flux" : "traced";
+}
+
+// One line per tuning, <SizeX> <SizeY> <flux|traced> <threads> <rows> <steps/s> <cpu>, the last one for a grid and cpu counts
+bool LoadTuning(const char* Path, const SimulationVariables& Variables, int SizeX, int SizeY, WorldTuning& Out)
+{
+	std::ifstream File(Path);
+	std::string CPU = GetCPUName();
+	std::string Line;
+	bool Found = false;
+	while (std::getline(File, Line))
+	{
+		std::istringstream In(Line);
+		int LineSizeX, LineSizeY;
+		std::string Transport, LineCPU;
+		WorldTuning Tuning;
+		if (!(In >> LineSizeX >> LineSizeY >> Transport >> Tuning.NumThreads >> Tuning.RowsPerTile >> Tuning.StepsPerSecond))
+			continue;
+		std::getline(In >> std::ws, LineCPU);
+
+		if (LineSizeX == SizeX && LineSizeY == SizeY && Transport == GetTransportKey(Variables) && LineCPU == CPU && Tuning.NumThreads > 0 && Tuning.RowsPerTile > 0)
+		{
+			Out = Tuning;
+			Found = true;
+		}
+	}
+	return Found;
+}
+
+static double Measure(const SimulationVariables& Variables, const Cell2D* Cells, std::vector<Cell2D>& Copy, int SizeX, int SizeY, int NumThreads, int RowsPerTile)
+{
+	std::copy(Cells, Cells + SizeX * SizeY, Copy.begin());
+	World2D World(Copy.data(), SizeX, SizeY, NumThreads, RowsPerTile);
+	World.UpdateCells(Variables, WARMUP_STEPS);
+
+	int Steps = 0;
+	auto StartTime = std::chrono::steady_clock::now();
+	std::chrono::duration<double> Elapsed(0);
+	while (Elapsed.count() < MIN_SECONDS && !World.IsBlownUp())
+	{
+		World.UpdateCells(Variables, 2);
+		Steps += 2;
+		Elapsed = std::chrono::steady_clock::now() - StartTime;
+	}
+	return Steps > 0 ? Steps / Elapsed.count() : 0;
+}
+
+WorldTuning TuneWorld(const char* Path, const SimulationVariables& Variables, const Cell2D* Cells, int SizeX, int SizeY)
+{
+	std::vector<Cell2D> Copy(Cells, Cells + SizeX * SizeY);
+	int MaxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	// Short tiles are more tiles to spread over the threads, tall ones less waiting at their edges
+	std::vector<int> Rows;
+	for (int Height = 2; Height <= std::min(64, SizeY - 2); Height *= 2)
+		Rows.push_back(Height);
+	if (Rows.empty())
+		Rows.push_back(1);
+
+	std::vector<int> Threads;
+	for (int Count = 1; Count < MaxThreads; Count *= 2)
+		Threads.push_back(Count);
+	Threads.push_back(MaxThreads);
+
+	WorldTuning Best;
+	Best.NumThreads = MaxThreads;
+	Best.RowsPerTile = Rows[0];
+	for (int Height : Rows)
+	{
+		double StepsPerSecond = Measure(Variables, Cells, Copy, SizeX, SizeY, MaxThreads, Height);
+		std::cerr << "tune threads " << MaxThreads << " rows " << Height << ": " << StepsPerSecond << " steps/s" << std::endl;
+		if (StepsPerSecond > Best.StepsPerSecond)
+		{
+			Best.RowsPerTile = Height;
+			Best.StepsPerSecond = StepsPerSecond;
+		}
+	}
+
+	// A small grid can be faster on fewer threads than there are
+	for (int Count : Threads)
+	{
+		if (Count == MaxThreads)
+			continue;
+		double StepsPerSecond = Measure(Variables, Cells, Copy, SizeX, SizeY, Count, Best.RowsPerTile);
+		std::cerr << "tune threads " << Count << " rows " << Best.RowsPerTile << ": " << StepsPerSecond << " steps/s" << std::endl;
+		if (StepsPerSecond > Best.StepsPerSecond)
+		{
+			Best.NumThreads = Count;
+			Best.StepsPerSecond = StepsPerSecond;
+		}
+	}
+
+	std::ofstream File(Path, std::ios::app);
+	File << SizeX << " " << SizeY << " " << GetTransportKey(Variables) << " " << Best.NumThreads << " " << Best.RowsPerTile << " " << Best.StepsPerSecond << " " << GetCPUName() << std::endl;
+	if (!File)
+		std::cerr << "Can't write the tuning to " << Path << std::endl;
+	return Best;
+}
@@ -0,0 +1,28 @@
+#ifndef AUTOTUNE_HPP
+#define AUTOTUNE_HPP
+
+#include <string>
+#include "SimulationVariables.hpp"
+#include "Cell2D.hpp"
+
+// What a World2D is made with, 0 threads is one per core
+struct WorldTuning
+{
+	int NumThreads = 0;
+	int RowsPerTile = 8;
+	double StepsPerSecond = 0;	// what it got while tuning, 0 if it wasn't
+};
+
+// The model name of /proc/cpuinfo, with the number of threads there are, the same model can be a different machine otherwise
+std::string GetCPUName();
+
+// The tuning of a SizeX x SizeY grid on this CPU from the cache file at Path, returns false if it was never tuned
+// The semi-Lagrangian transports trace every row, which costs more than the flux, so they are tuned apart
+bool LoadTuning(const char* Path, const SimulationVariables& Variables, int SizeX, int SizeY, WorldTuning& Out);
+
+// Steps a copy of Cells for a moment with every tile height (at all threads), then every thread count (at the best height),
+// and adds the fastest to the cache file, the cells themselves aren't changed
+// The progress goes to stderr, stdout can be the video of an export
+WorldTuning TuneWorld(const char* Path, const SimulationVariables& Variables, const Cell2D* Cells, int SizeX, int SizeY);
+
+#endif
@@ -0,0 +1,48 @@
+#include "Brush.hpp"
+#include <algorithm>
+
+void GetBrushBounds(const BrushCommand& Command, int SizeX, int SizeY, int& LowX, int& LowY, int& HighX, int& HighY)
+{
+	LowX = std::max(Command.X - Command.Range, 1);
+	HighX = std::min(Command.X + Command.Range, SizeX - 1);
+	LowY = std::max(Command.Y - Command.Range, 1);
+	HighY = std::min(Command.Y + Command.Range, SizeY - 1);
+}
+
+bool IsTerrainBrush(const BrushCommand& Command)
+{
+	return Command.Tool == BrushTool::Flatten || (Command.Tool == BrushTool::Terrain && (Command.Add || Command.Remove));
+}
+
+void ApplyBrush(const BrushCommand& Command, float TargetHeight, int x, int y, Cell2D& Cell)
+{
+	float OX = x - Command.X;
+	float OY = y - Command.Y;
+
+	float SqrDist = OX * OX + OY * OY;
+	float MaxSqrDist = Command.Range * Command.Range;
+
+	float Strength = 1 - (SqrDist / MaxSqrDist);
+	if (Strength < 0)
+		return;
+
+	float StrengthMult = Command.Strength;
+	if (Command.Tool == BrushTool::Flatten) {
+		Cell.TerrainHeight += (TargetHeight - Cell.TerrainHeight) * Strength;
+	} else if (Command.Tool == BrushTool::Terrain) {
+		if (Command.Add)
+			Cell.TerrainHeight += Strength / 5 * StrengthMult;
+		if (Command.Remove)
+			Cell.TerrainHeight -= Strength / 5 * StrengthMult;
+	} else if (Command.Tool == BrushTool::Sediment) {
+		if (Command.Add)
+			Cell.Sediment += Strength / 5 * StrengthMult;
+		if (Command.Remove)
+			Cell.Sediment *= 1 - Strength;
+	} else {
+		if (Command.Add)
+			Cell.WaterHeight += Strength / 5 * StrengthMult;
+		if (Command.Remove)
+			Cell.WaterHeight *= 1 - Strength;
+	}
+}
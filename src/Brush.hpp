@@ -0,0 +1,35 @@
+#ifndef BRUSH_HPP
+#define BRUSH_HPP
+
+#include "Cell2D.hpp"
+
+enum class BrushTool {
+	Flatten,	// Q, pulls the terrain to the height under the cursor
+	Terrain,	// SPACE, raises (Add) or lowers (Remove) the terrain
+	Sediment,	// W, adds or removes sediment
+	Water		// no key, adds or removes water
+};
+
+// One frame of a brush, the strength falls off from 1 at X, Y to 0 at Range cells away
+// The World2D queues them and applies them at the start of its next step (see World2D::QueueBrush)
+struct BrushCommand
+{
+	BrushTool Tool;
+	int X;
+	int Y;
+	int Range;
+	float Strength;	// 1, 5 with shift
+	bool Add;		// left mouse button
+	bool Remove;	// right mouse button
+};
+
+// The cells it can change are in [LowX, HighX) x [LowY, HighY), never the ghosts
+void GetBrushBounds(const BrushCommand& Command, int SizeX, int SizeY, int& LowX, int& LowY, int& HighX, int& HighY);
+
+// If it can make slopes the solver doesn't know about
+bool IsTerrainBrush(const BrushCommand& Command);
+
+// Changes the cell at x, y (inside the bounds) the way the brush does, Flatten pulls it to TargetHeight
+void ApplyBrush(const BrushCommand& Command, float TargetHeight, int x, int y, Cell2D& Cell);
+
+#endif
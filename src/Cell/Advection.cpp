@@ -0,0 +1,79 @@
+#include "Advection.hpp"
+#include <cmath>
+
+Advection::Advection(const SimulationVariables& Variables, const float* Plane, int SizeX, int SizeY) : Plane(Plane), SizeX(SizeX), SizeY(SizeY), Boundary(Variables.Boundary) { }
+
+// The two cells (along one axis) P lies between, and how much of the second one it gets
+static void Locate(BoundaryPolicy Boundary, float P, int Size, int& I0, int& I1, float& F)
+{
+	if (Boundary == BoundaryPolicy::Periodic)
+	{
+		int Width = Size - 2;
+		P -= 1;
+		P -= std::floor(P / Width) * Width;
+		I0 = std::min((int)P, Width - 1);
+		F = P - I0;
+		I0 += 1;
+		I1 = I0 == Size - 2 ? 1 : I0 + 1;
+	}
+	else
+	{
+		int Low = Boundary == BoundaryPolicy::Open ? 0 : 1;
+		int High = Size - 1 - Low;
+		P = std::min(std::max(P, (float)Low), (float)High);
+		I0 = (int)P;
+		F = P - I0;
+		I1 = std::min(I0 + 1, High);
+	}
+
+	// Right on a cell the next one isn't read at all, it can be in a row another tile is writing
+	if (F == 0)
+		I1 = I0;
+}
+
+static float Lerp(float A, float B, float T)
+{
+	return A + (B - A) * T;
+}
+
+void Advection::TraceRow(int y, const float* DisplacementX, const float* DisplacementY, float* Out, float* Min, float* Max) const
+{
+	if (!DisplacementY)
+	{
+		for (int x = 1; x < SizeX - 1; x++)
+		{
+			int X0, X1;
+			float FX;
+			Locate(Boundary, x - DisplacementX[x], SizeX, X0, X1, FX);
+
+			float A = Plane[X0];
+			float B = Plane[X1];
+			Out[x] = Lerp(A, B, FX);
+			if (Min)
+			{
+				Min[x] = std::min(A, B);
+				Max[x] = std::max(A, B);
+			}
+		}
+		return;
+	}
+
+	for (int x = 1; x < SizeX - 1; x++)
+	{
+		int X0, X1, Y0, Y1;
+		float FX, FY;
+		Locate(Boundary, x - DisplacementX[x], SizeX, X0, X1, FX);
+		Locate(Boundary, y - DisplacementY[x], SizeY, Y0, Y1, FY);
+
+		float A = Plane[X0 + Y0 * SizeX];
+		float B = Plane[X1 + Y0 * SizeX];
+		float C = Plane[X0 + Y1 * SizeX];
+		float D = Plane[X1 + Y1 * SizeX];
+		Out[x] = Lerp(Lerp(A, B, FX), Lerp(C, D, FX), FY);
+		if (Min)
+		{
+			Min[x] = std::min(std::min(A, B), std::min(C, D));
+			Max[x] = std::max(std::max(A, B), std::max(C, D));
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef ADVECTION_HPP
+#define ADVECTION_HPP
+
+#include <algorithm>
+#include "SimulationVariables.hpp"
+
+// Semi-Lagrangian transport, a cell takes what was at the point its flow came from, a bilinear sample of the old values
+// Plane holds the old values of the whole grid (SizeX * SizeY, with the ghost ring), SizeY is 1 for a 1D grid
+// The edges are the same as for the pipes: Closed clamps to the interior, Open reads the ghosts (which have to be 0),
+// Periodic wraps around the interior
+// A displacement is never more than 1 cell (see GetDisplacement), so a row only ever reads itself and the rows next to it
+struct Advection
+{
+	const float* Plane;
+	int SizeX;
+	int SizeY;
+	BoundaryPolicy Boundary;
+
+
+	Advection(const SimulationVariables& Variables, const float* Plane, int SizeX, int SizeY);
+
+	// Velocity is the flux of the pipes, a volume per second, what a cell moves in a step is that volume spread over its water column, in cells
+	// The pipes never let a cell give away more than it holds, so the water never gets further than the next cell in a step,
+	// without the clamp the thin water at the front of a flood would trace its sediment from cells the water never came from
+	// That also means a trace never goes further than the flux would, a bigger DT than the pipes are stable with doesn't work with it either
+	static float GetDisplacement(const SimulationVariables& Variables, float Velocity, float LiquidHeight)
+	{
+		float Volume = LiquidHeight * Variables.PIPE_LENGTH * Variables.PIPE_LENGTH;
+		float Moved = Velocity * Variables.DT;
+		return Moved >= Volume ? 1 : Moved <= -Volume ? -1 : Moved / Volume;
+	}
+
+	// Cells of row y moved by DisplacementX, DisplacementY (in cells, nullptr for a 1D grid) during the step, Out[x] gets what they carry now
+	// Min and Max (both or neither) get the range of the values that were blended, for the MacCormack limiter
+	void TraceRow(int y, const float* DisplacementX, const float* DisplacementY, float* Out, float* Min, float* Max) const;
+
+	// MacCormack, Traced is the trace of Old, and Back the trace of Traced back the other way
+	// Whatever the round trip lost is twice what one trace loses, so half of it is added back
+	// Where that would leave the range of the cells the trace blended it keeps the plain trace, so it never overshoots
+	static float Correct(float Old, float Traced, float Back, float Min, float Max)
+	{
+		float Corrected = Traced + (Old - Back) / 2;
+		return Corrected < Min || Corrected > Max ? Traced : Corrected;
+	}
+};
+
+#endif
@@ -1,7 +1,8 @@
 #include "Cell.hpp"
 #include <cmath>
+#include <algorithm>
 
-Cell::Cell() : TerrainHeight(0), WaterHeight(0), Sediment(0), TempWaterHeight(0), TempSediment(0) { }
+Cell::Cell() : TerrainHeight(0), WaterHeight(0), Sediment(0) { }
 Cell::Cell(const Cell& From)
 {
 	this->operator=(From);
@@ -14,8 +15,6 @@ Cell& Cell::operator = (const Cell& From)
 	TerrainHeight = From.TerrainHeight;
 	WaterHeight = From.WaterHeight;
 	Sediment = From.Sediment;
-	TempWaterHeight = From.TempWaterHeight;
-	TempSediment = From.TempSediment;
 
 	// return the existing object so we can chain this operator
 	return *this;
@@ -54,18 +53,18 @@ float Cell::GetSedimentForVolume(const SimulationVariables& Variables, float Vol
 	return GetVolumePR(Variables, Volume) * Sediment;
 }
 
-void Cell::UpdateRainfall(const SimulationVariables& Variables, float Rainfall)
+void Cell::UpdateRainfall(const SimulationVariables& Variables, float Rainfall, unsigned int Random)
 {
-	if ((std::rand() % Variables.RainRandom) == 0)
+	if ((Random % Variables.RainRandom) == 0)
 		WaterHeight += Rainfall * Variables.RainRandom * Variables.DT;
 }
 
-void Cell::FinishWaterSurfaceAndSediment()
+void Cell::FinishWaterSurfaceAndSediment(const CellUpdate& Update)
 {
 	// Is max really needed?
-	WaterHeight = std::max(TempWaterHeight, 0.0f);
-	Sediment = std::max(TempSediment, 0.0f);
-	TerrainHeight = TempTerrainHeight;
+	WaterHeight = std::max(Update.WaterHeight, 0.0f);
+	Sediment = std::max(Update.Sediment, 0.0f);
+	TerrainHeight = Update.TerrainHeight;
 }
 
 void Cell::UpdateErosionAndDeposition(const SimulationVariables& Variables)
@@ -76,6 +75,8 @@ void Cell::UpdateErosionAndDeposition(const SimulationVariables& Variables)
 
 	float SedimentChange = Diff > 0 ? Diff * Variables.DISSOLVE_CONSTANT : Diff * Variables.DEPOSITION_CONSTANT;
 	SedimentChange *= Variables.DT;
+	// DEPOSITION_CONSTANT * DT is 1 by default, in floats a bit more, never deposit more than there is
+	SedimentChange = std::max(SedimentChange, -Sediment);
 
 	TerrainHeight -= SedimentChange;
 	Sediment += SedimentChange;
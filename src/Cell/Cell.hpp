@@ -4,6 +4,14 @@
 #include <ostream>
 #include "Pipe.hpp"
 
+// The heights a cell gets at the end of the step, they can only be written back once every neighbour is done reading the old ones
+// The solvers keep these in a few rows of scratch, not in every cell
+struct CellUpdate {
+	float TerrainHeight;
+	float WaterHeight;
+	float Sediment;
+};
+
 // A Slight modification from https://hal.inria.fr/inria-00402079/document
 // Only sediment transport is changed, maybe i implemented the transport wrong, but now every bit of terrain is preserved, Also no local tilt angle
 
@@ -31,18 +39,14 @@ class Cell {
 		float GetWaterForVolume(const SimulationVariables& Variables, float Volume);
 		float GetSedimentForVolume(const SimulationVariables& Variables, float Volume);
 
-		void UpdateRainfall(const SimulationVariables& Variables, float Rainfall);
+		// A drop falls when Random % RainRandom is 0, the caller picks the random number so it can make it repeatable
+		void UpdateRainfall(const SimulationVariables& Variables, float Rainfall, unsigned int Random);
 
-		void FinishWaterSurfaceAndSediment();
+		void FinishWaterSurfaceAndSediment(const CellUpdate& Update);
 
 		void UpdateErosionAndDeposition(const SimulationVariables& Variables);
 
 		void UpdateEvaporation(const SimulationVariables& Variables);
-	protected:
-		float TempTerrainHeight;
-		float TempWaterHeight;
-		float TempSediment;
-		
 };
 
 #endif
@@ -1,6 +1,9 @@
 #include "Cell1D.hpp"
+#include "Diagnostics.hpp"
+#include "Advection.hpp"
 #include <cmath>
 #include <iostream>
+#include <string>
 
 #include <chrono>
 #include <thread>
@@ -66,20 +69,20 @@ void Cell1D::UpdateWaterSurface(const SimulationVariables& Variables, Cell1D& Le
 }
 */
 
-void Cell1D::UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, Cell1D& LeftCell, Cell1D& RightCell)
+void Cell1D::UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, Cell1D& LeftCell, Cell1D& RightCell, CellUpdate& Out)
 {
-	TempWaterHeight = WaterHeight 
+	Out.WaterHeight = WaterHeight 
 		+ LeftCell.GetWaterForVolume(Variables, LeftCell.Right.FlowVolume * Variables.DT) + RightCell.GetWaterForVolume(Variables, RightCell.Left.FlowVolume * Variables.DT)
 		- GetWaterForVolume(Variables, (Left.FlowVolume + Right.FlowVolume) * Variables.DT);
 
 	// Now for the sediment
-	TempSediment = Sediment
+	Out.Sediment = Sediment
 		+ LeftCell.GetSedimentForVolume(Variables, LeftCell.Right.FlowVolume * Variables.DT) + RightCell.GetSedimentForVolume(Variables, RightCell.Left.FlowVolume * Variables.DT)
 		- GetSedimentForVolume(Variables, (Left.FlowVolume + Right.FlowVolume) * Variables.DT);
 
 	Velocity = (LeftCell.Right.FlowVolume - Left.FlowVolume - RightCell.Left.FlowVolume + Right.FlowVolume) / 2;
 
-	TempTerrainHeight = TerrainHeight;	// No steepness function
+	Out.TerrainHeight = TerrainHeight;	// No steepness function
 }
 
 /*
@@ -105,28 +108,109 @@ void Cell1D::FinishSedimentTransport()
 */
 
 
-void Cell1D::UpdateCells(const SimulationVariables& Variables, Cell1D* Ptr, int Size)
+// Same as the ghost cells of Cell2D, the first and last cell are never simulated
+static void FillGhostCell(const SimulationVariables& Variables, Cell1D& Ghost, const Cell1D& Inside, const Cell1D& Opposite)
+{
+	if (Variables.Boundary == BoundaryPolicy::Periodic)
+	{
+		Ghost.TerrainHeight = Opposite.TerrainHeight;
+		Ghost.WaterHeight = Opposite.WaterHeight;
+		Ghost.Sediment = Opposite.Sediment;
+		return;
+	}
+
+	Ghost.TerrainHeight = Inside.TerrainHeight;
+	Ghost.WaterHeight = Variables.Boundary == BoundaryPolicy::Closed ? Inside.WaterHeight : 0;
+	Ghost.Sediment = Variables.Boundary == BoundaryPolicy::Closed ? Inside.Sediment : 0;
+	Ghost.Left.FlowVolume = 0;
+	Ghost.Right.FlowVolume = 0;
+}
+
+// The sediment every cell has once it moved with the flow (see Advection), along the velocity of the last step,
+// the pipes of this one don't say where the water went until the surface is done
+// Returns where in Scratch it is
+static float* AdvectSediment(const SimulationVariables& Variables, const Cell1D* Ptr, int Size, float* Scratch)
+{
+	float* Old = Scratch;
+	float* Displacement = Scratch + Size;
+	float* Traced = Scratch + Size * 2;
+	float* Min = Scratch + Size * 3;
+	float* Max = Scratch + Size * 4;
+	float* Back = Scratch + Size * 5;
+	for (int i = 0; i < Size; i++)
+	{
+		Old[i] = Ptr[i].Sediment;
+		Displacement[i] = Advection::GetDisplacement(Variables, Ptr[i].Velocity, Ptr[i].GetLiquidHeight());
+	}
+
+	bool Correct = Variables.Transport == SedimentTransport::MacCormack;
+	Advection(Variables, Old, Size, 1).TraceRow(0, Displacement, nullptr, Traced, Correct ? Min : nullptr, Correct ? Max : nullptr);
+	if (!Correct)
+		return Traced;
+
+	// The ghosts of Traced stay 0, which is what Open needs
+	Traced[0] = 0;
+	Traced[Size - 1] = 0;
+	for (int i = 0; i < Size; i++)
+		Displacement[i] = -Displacement[i];
+	Advection(Variables, Traced, Size, 1).TraceRow(0, Displacement, nullptr, Back, nullptr, nullptr);
+	for (int i = 1; i < Size - 1; i++)
+		Traced[i] = Advection::Correct(Old[i], Traced[i], Back[i], Min[i], Max[i]);
+	return Traced;
+}
+
+int Cell1D::GetScratchSize(int Size)
+{
+	return Size * 6;
+}
+
+void Cell1D::UpdateCells(const SimulationVariables& Variables, Cell1D* Ptr, int Size, float* Scratch)
 {
 	for (int i = 1; i < Size - 1; i++)
 		//Ptr[i].UpdateRainfall(RAINFALL);
-		Ptr[i].UpdateRainfall(Variables, i > Size / 2 ? Variables.RAINFALL : 0);
+		Ptr[i].UpdateRainfall(Variables, i > Size / 2 ? Variables.RAINFALL : 0, std::rand());
+
+	FillGhostCell(Variables, Ptr[0], Ptr[1], Ptr[Size - 2]);
+	FillGhostCell(Variables, Ptr[Size - 1], Ptr[Size - 2], Ptr[1]);
 
 	for (int i = 1; i < Size - 1; i++)
 		Ptr[i].UpdatePipes(Variables, Ptr[i - 1], Ptr[i + 1]);
-	
+
 	// Boundary condition
-	Ptr[1].Left.FlowVolume = 0;
-	Ptr[Size - 2].Right.FlowVolume = 0;
+	if (Variables.Boundary == BoundaryPolicy::Closed)
+	{
+		Ptr[1].Left.FlowVolume = 0;
+		Ptr[Size - 2].Right.FlowVolume = 0;
+	}
+	else if (Variables.Boundary == BoundaryPolicy::Periodic)
+	{
+		Ptr[0].Right = Ptr[Size - 2].Right;
+		Ptr[Size - 1].Left = Ptr[1].Left;
+	}
 
 	/*
 	for (int i = 1; i < Size - 1; i++)
 		Ptr[i].UpdateWaterSurface(Variables, Ptr[i - 1], Ptr[i + 1]);
 	*/
 
+	float* Advected = nullptr;
+	if (Variables.Transport != SedimentTransport::Flux)
+		Advected = AdvectSediment(Variables, Ptr, Size, Scratch);
+
+	// A cell can take its new heights as soon as the cell after it is done reading the old ones
+	CellUpdate Pending;
+	CellUpdate Current;
 	for (int i = 1; i < Size - 1; i++)
-		Ptr[i].UpdateWaterSurfaceAndSediment(Variables, Ptr[i - 1], Ptr[i + 1]);
-	for (int i = 1; i < Size - 1; i++)
-		Ptr[i].FinishWaterSurfaceAndSediment();
+	{
+		Ptr[i].UpdateWaterSurfaceAndSediment(Variables, Ptr[i - 1], Ptr[i + 1], Current);
+		if (Advected)
+			Current.Sediment = Advected[i];
+		if (i > 1)
+			Ptr[i - 1].FinishWaterSurfaceAndSediment(Pending);
+		Pending = Current;
+	}
+	if (Size > 2)
+		Ptr[Size - 2].FinishWaterSurfaceAndSediment(Pending);
 
 	for (int i = 1; i < Size - 1; i++)
 		Ptr[i].UpdateErosionAndDeposition(Variables);
@@ -187,9 +271,8 @@ static std::string GetHeightPrintDouble(Cell1D* Ptr, int Size, float Height)
 }
 */
 
-static std::string GetHeightPrint(Cell1D* Ptr, int Size, float Height)
+static void GetHeightPrint(Cell1D* Ptr, int Size, float Height, std::string& Print)
 {
-	std::string Print = "";
 	for (int i = 0; i < Size; i++)
 	{
 		Cell1D& Curr = Ptr[i];
@@ -211,40 +294,33 @@ static std::string GetHeightPrint(Cell1D* Ptr, int Size, float Height)
 			Print += " ";
 	}
 
-	return Print + "\n";
+	Print += "\n";
 }
 
 void Cell1D::DrawCells(const SimulationVariables& Variables, Cell1D* Ptr, int Size, int NumPartitions, float HeightScale)
 {
-	bool ErrorHeight = false;
-
-	float TotalWaterVolume = 0;
-	float TotalSedimentVolume = 0;
-	float TotalTerrainVolume = 0;
-
+	Diagnostics Stats;
 	for (int i = 0; i < Size; i++)
-	{
-		TotalWaterVolume += Ptr[i].WaterHeight * Variables.PIPE_LENGTH * Variables.PIPE_LENGTH;
-		TotalSedimentVolume += Ptr[i].Sediment * Variables.PIPE_LENGTH * Variables.PIPE_LENGTH;
-		TotalTerrainVolume += Ptr[i].TerrainHeight * Variables.PIPE_LENGTH * Variables.PIPE_LENGTH;
+		Stats.Add(Ptr[i], Ptr[i].Cell1D::GetVelocityMagnitude(), i);
 
-		ErrorHeight |= Ptr[i].WaterHeight < 0 || Ptr[i].Sediment < 0;
-	}
+	float Area = Variables.PIPE_LENGTH * Variables.PIPE_LENGTH;
 
-	std::string HeightPrint = "";
+	// Kept between frames, after the first one it already has the room for the whole picture
+	static std::string HeightPrint;
+	HeightPrint.clear();
 	for (int i = 0; i < NumPartitions; i++)
 	{
 		float Height = (NumPartitions - 1 - i) * Variables.PIPE_LENGTH * HeightScale;
-		HeightPrint += GetHeightPrint(Ptr, Size, Height);
+		GetHeightPrint(Ptr, Size, Height, HeightPrint);
 	}
 
 	std::cout << HeightPrint;
 
-	std::cout << "Water Volume: " << TotalWaterVolume << std::endl;
-	std::cout << "Sediment Volume: " << TotalSedimentVolume << std::endl;
-	std::cout << "Terrain Volume: " << TotalTerrainVolume << std::endl;
-	std::cout << "Sediment + Terrain Volume: " << (TotalSedimentVolume + TotalTerrainVolume) << std::endl;
+	std::cout << "Water Volume: " << Stats.Water.Sum * Area << std::endl;
+	std::cout << "Sediment Volume: " << Stats.Sediment.Sum * Area << std::endl;
+	std::cout << "Terrain Volume: " << Stats.Terrain.Sum * Area << std::endl;
+	std::cout << "Sediment + Terrain Volume: " << (Stats.Sediment.Sum + Stats.Terrain.Sum) * Area << std::endl;
 
-	if (ErrorHeight || std::isnan(TotalWaterVolume) || std::isnan(TotalSedimentVolume) || std::isnan(TotalTerrainVolume))
+	if (Stats.IsBlownUp())
 		std::this_thread::sleep_for(std::chrono::seconds(1));
 }
@@ -26,14 +26,16 @@ class Cell1D : public Cell {
 		void UpdateWaterSurface(const SimulationVariables& Variables, Cell1D& LeftCell, Cell1D& RightCell);
 		*/
 
-		void UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, Cell1D& LeftCell, Cell1D& RightCell);
+		void UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, Cell1D& LeftCell, Cell1D& RightCell, CellUpdate& Out);
 
 		/*
 		void UpdateSedimentTransport(Cell1D* Ptr, int Size, int Index);
 		void FinishSedimentTransport();
 		*/
 
-		static void UpdateCells(const SimulationVariables& Variables, Cell1D* Ptr, int Size);
+		// Scratch has room for GetScratchSize(Size) floats, the semi-Lagrangian transports work in it
+		static int GetScratchSize(int Size);
+		static void UpdateCells(const SimulationVariables& Variables, Cell1D* Ptr, int Size, float* Scratch);
 		static void DrawCells(const SimulationVariables& Variables, Cell1D* Ptr, int Size, int NumPartitions, float HeightScale = 1);
 };
 
@@ -1,8 +1,5 @@
 #include "Cell2D.hpp"
 #include <cmath>
-#include <thread>
-#include <vector>
-#include <atomic>
 
 Cell2D::Cell2D() : Cell(), Velocity(), Left(), Right(), Up(), Down() { }
 Cell2D::Cell2D(const Cell2D& From)
@@ -19,6 +16,8 @@ Cell2D& Cell2D::operator = (const Cell2D& From)
 	Velocity = From.Velocity;
 	Left = From.Left;
 	Right = From.Right;
+	Up = From.Up;
+	Down = From.Down;
 
 	// return the existing object so we can chain this operator
 	return *this;
@@ -51,14 +50,14 @@ void Cell2D::UpdatePipes(const SimulationVariables& Variables, Cell2D& LeftCell,
 	Down.ScaleBack(K);
 }
 
-void Cell2D::UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell)
+void Cell2D::UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell, CellUpdate& Out)
 {
-	TempWaterHeight = WaterHeight
+	Out.WaterHeight = WaterHeight
 		+ LeftCell.GetWaterForVolume(Variables, LeftCell.Right.FlowVolume * Variables.DT) + RightCell.GetWaterForVolume(Variables, RightCell.Left.FlowVolume * Variables.DT)
 		+ UpCell.GetWaterForVolume(Variables, UpCell.Down.FlowVolume * Variables.DT) + DownCell.GetWaterForVolume(Variables, DownCell.Up.FlowVolume * Variables.DT)
 		- GetWaterForVolume(Variables, (Left.FlowVolume + Right.FlowVolume + Up.FlowVolume + Down.FlowVolume) * Variables.DT);
 		
-	TempSediment = Sediment
+	Out.Sediment = Sediment
 		+ LeftCell.GetSedimentForVolume(Variables, LeftCell.Right.FlowVolume * Variables.DT) + RightCell.GetSedimentForVolume(Variables, RightCell.Left.FlowVolume * Variables.DT)
 		+ UpCell.GetSedimentForVolume(Variables, UpCell.Down.FlowVolume * Variables.DT) + DownCell.GetSedimentForVolume(Variables, DownCell.Up.FlowVolume * Variables.DT)
 		- GetSedimentForVolume(Variables, (Left.FlowVolume + Right.FlowVolume + Up.FlowVolume + Down.FlowVolume) * Variables.DT);
@@ -69,88 +68,23 @@ void Cell2D::UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables,
 }
 
 static const float DiagonalMultiplier = sqrt(2);
-void Cell2D::UpdateSteepness(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell, Cell2D& UpLeftCell, Cell2D& UpRightCell, Cell2D& DownLeftCell, Cell2D& DownRightCell)
+bool Cell2D::UpdateSteepness(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell, Cell2D& UpLeftCell, Cell2D& UpRightCell, Cell2D& DownLeftCell, Cell2D& DownRightCell, CellUpdate& Out)
 {
 	float SqrDist = Variables.PIPE_LENGTH * DiagonalMultiplier;
 
-	float Change = (GetHeightChange(Variables, LeftCell, Variables.PIPE_LENGTH) + GetHeightChange(Variables, RightCell, Variables.PIPE_LENGTH) + GetHeightChange(Variables, UpCell, Variables.PIPE_LENGTH) + GetHeightChange(Variables, DownCell, Variables.PIPE_LENGTH)
-	+ GetHeightChange(Variables, UpLeftCell, SqrDist) + GetHeightChange(Variables, UpRightCell, SqrDist) + GetHeightChange(Variables, DownLeftCell, SqrDist) + GetHeightChange(Variables, DownRightCell, SqrDist)) / 8;
-	TempTerrainHeight = TerrainHeight + Change;
-}
-
-template<class T>
-struct CallRange
-{
-	int StartIndex;
-	int EndIndex;
-	T Func;
-
-	void Run()
-	{
-		for (int i = StartIndex; i < EndIndex; i++)
-			Func(i);
-	}
-
-	CallRange(int StartIndex, int EndIndex, T Func) : StartIndex(StartIndex), EndIndex(EndIndex), Func(Func) { }
-};
-
-template<class T>
-static void RunThreaded(const SimulationVariables& Variables, Cell2D* Ptr, int SizeX, int SizeY, int NumThreads, T Func)
-{
-	std::vector<CallRange<T>> Ranges;
-
-	for (int y = 1; y < SizeY - 1; y++)
-		Ranges.push_back(CallRange<T>(1 + y * SizeY, SizeX - 1 + y * SizeY, Func));
-
-	std::atomic_size_t Current(0);
-
-	std::thread* Threads = new std::thread[NumThreads];
-	for (int i = 0; i < NumThreads; i++)
-		Threads[i] = std::thread([&]() {	// I dont like that i have to use pointers, i'd rather use a reference
-			while (true)
-			{
-				size_t I = Current.fetch_add(1);
-				if (I >= Ranges.size())
-					break;
-
-				Ranges[I].Run();
-			}
-		});
-	
-	for (int i = 0; i < NumThreads; i++)
-		Threads[i].join();
-	delete[] Threads;
-}
+	float Changes[8] = {
+		GetHeightChange(Variables, LeftCell, Variables.PIPE_LENGTH), GetHeightChange(Variables, RightCell, Variables.PIPE_LENGTH), GetHeightChange(Variables, UpCell, Variables.PIPE_LENGTH), GetHeightChange(Variables, DownCell, Variables.PIPE_LENGTH),
+		GetHeightChange(Variables, UpLeftCell, SqrDist), GetHeightChange(Variables, UpRightCell, SqrDist), GetHeightChange(Variables, DownLeftCell, SqrDist), GetHeightChange(Variables, DownRightCell, SqrDist)
+	};
 
-void Cell2D::UpdateCells(const SimulationVariables& Variables, Cell2D* Ptr, int SizeX, int SizeY)
-{
-	// Lambdas are AWESOME!
-	auto RunFunc = [&](auto Lambda) { RunThreaded(Variables, Ptr, SizeX, SizeY, std::thread::hardware_concurrency(), Lambda); };
+	float Change = (Changes[0] + Changes[1] + Changes[2] + Changes[3] + Changes[4] + Changes[5] + Changes[6] + Changes[7]) / 8;
+	Out.TerrainHeight = TerrainHeight + Change;
 
-	RunFunc([&](int i) { Ptr[i].UpdateRainfall(Variables, (std::rand() % 10) == 0 ? Variables.RAINFALL * 10 : 0); });
-	RunFunc([&](int i) { Ptr[i].UpdatePipes(Variables, Ptr[i - 1], Ptr[i + 1], Ptr[i - SizeX], Ptr[i + SizeX]); });
-	
-	// Boundary condition
-	for (int x = 1; x < SizeX - 1; x++)
-	{
-		Ptr[x + 1 * SizeX].Up.FlowVolume = 0;
-		Ptr[x + (SizeY - 2) * SizeX].Down.FlowVolume = 0;
-	}
-	for (int y = 1; y < SizeY - 1; y++)
-	{
-		Ptr[1 + y * SizeX].Left.FlowVolume = 0;
-		Ptr[SizeX - 2 + y * SizeX].Right.FlowVolume = 0;
-	}
-	
-	RunFunc([&](int i) {
-		Ptr[i].UpdateWaterSurfaceAndSediment(Variables, Ptr[i - 1], Ptr[i + 1], Ptr[i - SizeX], Ptr[i + SizeX]);
-		Ptr[i].UpdateSteepness(Variables, Ptr[i - 1], Ptr[i + 1], Ptr[i - SizeX], Ptr[i + SizeX], Ptr[i - 1 - SizeX], Ptr[i + 1 - SizeX], Ptr[i - 1 + SizeX], Ptr[i + 1 + SizeX]);
-	});
-	RunFunc([&](int i) {
-		Ptr[i].FinishWaterSurfaceAndSediment();
-		Ptr[i].UpdateErosionAndDeposition(Variables);
-		Ptr[i].UpdateEvaporation(Variables);
-	});
+	// The changes can cancel out, so Change == 0 doesn't mean its stable
+	bool Unstable = false;
+	for (int i = 0; i < 8; i++)
+		Unstable |= Changes[i] != 0;
+	return Unstable;
 }
 
 static float clamp(float v, float min, float max)
@@ -185,80 +119,32 @@ static int ToColor(float r, float g, float b)
 	return ToByte(r) << 24 | ToByte(g) << 16 | ToByte(b) << 8 | 255;
 }
 
-static std::pair<float, float> GetMinMax(Cell2D* Ptr, int SizeX, int SizeY, int StartX, int StartY, int EndX, int EndY)
-{
-	float Min = 100000;
-	float Max = -Min;
-
-	for (int x = StartX; x < EndX; x++)
-		for (int y = StartY; y < EndY; y++)
-		{
-			int i = x + y * SizeX;
-
-			Min = std::min(Min, Ptr[i].TerrainHeight);
-			Max = std::max(Max, Ptr[i].TerrainHeight);
-		}
-	
-	return std::make_pair(Min, Max);
-}
-
-void Cell2D::DrawImage(const SimulationVariables& Variables, mlx_image_t* img, Cell2D* Ptr, int SizeX, int SizeY, float Min, float Max, int PixelSize, int StartX, int StartY, int EndX, int EndY)
+// Terrain in grey from Min to Max, water makes it blue and sediment cyan, as 0xRRGGBBAA
+int Cell2D::GetColor(float Min, float Max) const
 {
-	if (EndX < 0) EndX += SizeX + 1;
-	if (EndY < 0) EndY += SizeY + 1;
+	float Terrain = map(TerrainHeight, Min, Max, 0, 1);
 
-	if (Min >= Max)
-	{
-		float MinSize = Min - Max;
+	float r = Terrain;
+	float g = Terrain;
+	float b = Terrain;
 
-		auto MinMax = GetMinMax(Ptr, SizeX, SizeY, StartX, StartY, EndX, EndY);
-		Min = MinMax.first;
-		Max = std::max(Min + MinSize, MinMax.second);
-	}
+	float WaterPR = sigmoid(WaterHeight);
+	float SedimentPR = sigmoid(Sediment);
 
-	//std::cout << "Draw (" << StartX << ", " << StartY << ") (" << EndX << ", " << EndY << ") x " << PixelSize << std::endl;
+	r = lerp(r, 0, WaterPR);
+	g = lerp(g, 0, WaterPR);
+	b = lerp(b, 1, WaterPR);
 
-	for (int x = StartX; x < EndX; x++)
-		for (int y = StartY; y < EndY; y++)
-		{
-			int i = x + y * SizeX;
+	r = lerp(r, 0, SedimentPR);
+	g = lerp(g, 1, SedimentPR);
+	b = lerp(b, 1, SedimentPR);
 
-			float TerrainHeight = map(Ptr[i].TerrainHeight, Min, Max, 0, 1);
-			float SedimentHeight = Ptr[i].Sediment;
-			float WaterHeight = Ptr[i].WaterHeight;
+	/*
+	float STC = GetSedimentTransportCapacity(Variables);
+	r = STC * 4;
+	g = r;
+	b = r;
+	*/
 
-			float r = TerrainHeight;
-			float g = TerrainHeight;
-			float b = TerrainHeight;
-
-			float WaterPR = sigmoid(WaterHeight);
-			float SedimentPR = sigmoid(SedimentHeight);
-			
-			r = lerp(r, 0, WaterPR);
-			g = lerp(g, 0, WaterPR);
-			b = lerp(b, 1, WaterPR);
-
-			r = lerp(r, 0, SedimentPR);
-			g = lerp(g, 1, SedimentPR);
-			b = lerp(b, 1, SedimentPR);
-
-			/*
-			float STC = Ptr[i].GetSedimentTransportCapacity(Variables);
-			r = STC * 4;
-			g = r;
-			b = r;
-			*/
-
-			int Color = ToColor(r, g, b);
-
-			int DrawX = (x - StartX) * PixelSize;
-			int DrawY = (y - StartY) * PixelSize;
-			for (int dx = 0; dx < PixelSize; dx++)
-				for (int dy = 0; dy < PixelSize; dy++)
-				{
-					//if (PixelSize != 1)
-					//	std::cout << "(" << DrawX << ", " << DrawY << ") / (" << dx << ", " << dy << ")" << std::endl;
-					mlx_put_pixel(img, DrawX + dx, DrawY + dy, Color);
-				}
-		}
-}
\ No newline at end of file
+	return ToColor(r, g, b);
+}
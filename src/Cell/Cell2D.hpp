@@ -5,9 +5,8 @@
 #include "Pipe.hpp"
 #include "Cell.hpp"
 
-extern "C" {
-	#include "MLX42.h"
-}
+// Only DrawImage needs MLX42, the solver doesn't, so it doesn't get the header
+typedef struct mlx_image mlx_image_t;
 
 class Cell2D : public Cell {
 	public:
@@ -27,11 +26,18 @@ class Cell2D : public Cell {
 		virtual float GetVelocityMagnitude() const;
 
 		void UpdatePipes(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell);
-		void UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell);
-		void UpdateSteepness(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell, Cell2D& UpLeftCell, Cell2D& UpRightCell, Cell2D& DownLeftCell, Cell2D& DownRightCell);
+		// These only read the old heights, the new ones go to Out
+		void UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell, CellUpdate& Out);
+		// Returns if any neighbour is more than MAX_STEP away, if not the terrain stays as is
+		bool UpdateSteepness(const SimulationVariables& Variables, Cell2D& LeftCell, Cell2D& RightCell, Cell2D& UpCell, Cell2D& DownCell, Cell2D& UpLeftCell, Cell2D& UpRightCell, Cell2D& DownLeftCell, Cell2D& DownRightCell, CellUpdate& Out);
 
-		static void UpdateCells(const SimulationVariables& Variables, Cell2D* Ptr, int SizeX, int SizeY);
+		// What DrawImage and the FrameExporter show for the cell, Min and Max are the terrain heights that go from black to white
+		int GetColor(float Min, float Max) const;
+
+		// In Cell2DDraw.cpp
 		static void DrawImage(const SimulationVariables& Variables, mlx_image_t* img, Cell2D* Ptr, int SizeX, int SizeY, float Min = 0, float Max = -1, int PixelSize = 1, int StartX = 0, int StartY = 0, int EndX = -1, int EndY = -1);
+		// Only the rows [StartY, EndY) of a whole grid, where they already are in the image, for redrawing what changed
+		static void DrawRows(mlx_image_t* img, const Cell2D* Ptr, int SizeX, float Min, float Max, int StartY, int EndY);
 };
 
 #endif
@@ -0,0 +1,67 @@
+#include "Cell2D.hpp"
+#include <algorithm>
+
+extern "C" {
+	#include "MLX42.h"
+}
+
+// The only part of the cells that needs MLX42, kept apart so the solver builds without it (see libwatersim)
+
+static std::pair<float, float> GetMinMax(Cell2D* Ptr, int SizeX, int SizeY, int StartX, int StartY, int EndX, int EndY)
+{
+	float Min = 100000;
+	float Max = -Min;
+
+	for (int y = StartY; y < EndY; y++)
+		for (int x = StartX; x < EndX; x++)
+		{
+			int i = x + y * SizeX;
+
+			Min = std::min(Min, Ptr[i].TerrainHeight);
+			Max = std::max(Max, Ptr[i].TerrainHeight);
+		}
+	
+	return std::make_pair(Min, Max);
+}
+
+void Cell2D::DrawImage(const SimulationVariables& Variables, mlx_image_t* img, Cell2D* Ptr, int SizeX, int SizeY, float Min, float Max, int PixelSize, int StartX, int StartY, int EndX, int EndY)
+{
+	if (EndX < 0) EndX += SizeX + 1;
+	if (EndY < 0) EndY += SizeY + 1;
+
+	if (Min >= Max)
+	{
+		float MinSize = Min - Max;
+
+		auto MinMax = GetMinMax(Ptr, SizeX, SizeY, StartX, StartY, EndX, EndY);
+		Min = MinMax.first;
+		Max = std::max(Min + MinSize, MinMax.second);
+	}
+
+	//std::cout << "Draw (" << StartX << ", " << StartY << ") (" << EndX << ", " << EndY << ") x " << PixelSize << std::endl;
+
+	for (int x = StartX; x < EndX; x++)
+		for (int y = StartY; y < EndY; y++)
+		{
+			int i = x + y * SizeX;
+
+			int Color = Ptr[i].GetColor(Min, Max);
+
+			int DrawX = (x - StartX) * PixelSize;
+			int DrawY = (y - StartY) * PixelSize;
+			for (int dx = 0; dx < PixelSize; dx++)
+				for (int dy = 0; dy < PixelSize; dy++)
+				{
+					//if (PixelSize != 1)
+					//	std::cout << "(" << DrawX << ", " << DrawY << ") / (" << dx << ", " << dy << ")" << std::endl;
+					mlx_put_pixel(img, DrawX + dx, DrawY + dy, Color);
+				}
+		}
+}
+
+void Cell2D::DrawRows(mlx_image_t* img, const Cell2D* Ptr, int SizeX, float Min, float Max, int StartY, int EndY)
+{
+	for (int y = StartY; y < EndY; y++)
+		for (int x = 0; x < SizeX; x++)
+			mlx_put_pixel(img, x, y, Ptr[x + y * SizeX].GetColor(Min, Max));
+}
@@ -0,0 +1,139 @@
+#include "CellLOD.hpp"
+#include <cmath>
+#include <algorithm>
+
+CellLOD::CellLOD() : Cell(), Velocity(), Size(1), BaseTerrainHeight(0), FaceStart(0), FaceCount(0), Corners{ -1, -1, -1, -1 }, Pending() { }
+CellLOD::CellLOD(const CellLOD& From)
+{
+	this->operator=(From);
+}
+
+CellLOD::~CellLOD() { }
+
+CellLOD& CellLOD::operator = (const CellLOD& From)
+{
+	static_cast<Cell&>(*this) = From;
+
+	Velocity = From.Velocity;
+	Size = From.Size;
+	BaseTerrainHeight = From.BaseTerrainHeight;
+	FaceStart = From.FaceStart;
+	FaceCount = From.FaceCount;
+	for (int i = 0; i < 4; i++)
+		Corners[i] = From.Corners[i];
+	Pending = From.Pending;
+
+	// return the existing object so we can chain this operator
+	return *this;
+}
+
+float CellLOD::GetVelocityMagnitude() const
+{
+	return std::abs(Velocity.first) + std::abs(Velocity.second);
+}
+
+// In fine cells
+float CellLOD::GetArea() const { return Size * Size; }
+
+// Same as the Cell versions but for a node Size cells wide, still a height of this node
+float CellLOD::GetNodeWaterForVolume(const SimulationVariables& Variables, float Volume)
+{
+	return GetWaterForVolume(Variables, Volume / GetArea());
+}
+float CellLOD::GetNodeSedimentForVolume(const SimulationVariables& Variables, float Volume)
+{
+	return GetSedimentForVolume(Variables, Volume / GetArea());
+}
+
+// Same as Cell2D::UpdatePipes, every node owns the pipes going out of it, so nodes can be updated in parallel
+void CellLOD::UpdatePipes(const SimulationVariables& Variables, CellLOD* Nodes, LODFace* Faces, const int* NodeFaces)
+{
+	float Height = GetCombinedHeight();
+	float Total = 0;
+
+	for (int i = FaceStart; i < FaceStart + FaceCount; i++)
+	{
+		LODFace& Face = Faces[NodeFaces[i]];
+		bool IsA = &Nodes[Face.A] == this;
+		Pipe& Out = IsA ? Face.AB : Face.BA;
+
+		Out.Update(Variables, Height, Nodes[IsA ? Face.B : Face.A].GetCombinedHeight(), Face.Distance * Variables.PIPE_LENGTH, Face.Width);
+		Total += Out.FlowVolume;
+	}
+
+	float CurrentVolume = GetLiquidHeight() * GetArea() * Variables.PIPE_LENGTH * Variables.PIPE_LENGTH;
+	float K = std::min(1.0f, CurrentVolume / (Total * Variables.DT));
+	if (std::isinf(K) || std::isnan(K))
+		K = 0;
+
+	for (int i = FaceStart; i < FaceStart + FaceCount; i++)
+	{
+		LODFace& Face = Faces[NodeFaces[i]];
+		(&Nodes[Face.A] == this ? Face.AB : Face.BA).ScaleBack(K);
+	}
+}
+
+// Whatever leaves a node is a height of that node, so scale it by the area to get the height it adds to this one
+void CellLOD::UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, CellLOD* Nodes, LODFace* Faces, const int* NodeFaces)
+{
+	float WaterIn = 0;
+	float SedimentIn = 0;
+	float TotalOut = 0;
+	float VelocityX = 0;
+	float VelocityY = 0;
+
+	for (int i = FaceStart; i < FaceStart + FaceCount; i++)
+	{
+		LODFace& Face = Faces[NodeFaces[i]];
+		bool IsA = &Nodes[Face.A] == this;
+		CellLOD& Other = Nodes[IsA ? Face.B : Face.A];
+		float In = (IsA ? Face.BA : Face.AB).FlowVolume;
+
+		float AreaScale = Other.GetArea() / GetArea();
+		WaterIn += Other.GetNodeWaterForVolume(Variables, In * Variables.DT) * AreaScale;
+		SedimentIn += Other.GetNodeSedimentForVolume(Variables, In * Variables.DT) * AreaScale;
+		TotalOut += (IsA ? Face.AB : Face.BA).FlowVolume;
+
+		// Positive flow along the axis, no matter which side of the node the face is on
+		float Flow = Face.AB.FlowVolume - Face.BA.FlowVolume;
+		if (Face.Axis == 0)
+			VelocityX += Flow;
+		else
+			VelocityY += Flow;
+	}
+
+	Pending.WaterHeight = WaterHeight + WaterIn - GetNodeWaterForVolume(Variables, TotalOut * Variables.DT);
+	Pending.Sediment = Sediment + SedimentIn - GetNodeSedimentForVolume(Variables, TotalOut * Variables.DT);
+
+	// Per fine cell of width, so it compares to the velocity of a Cell2D
+	Velocity = std::make_pair(VelocityX / 2 / Size, VelocityY / 2 / Size);
+}
+
+static const float DiagonalMultiplier = sqrt(2);
+// Like Cell2D::UpdateSteepness, the moved volume is shared so terrain stays preserved between nodes of different sizes
+// A face moves Width x Width fine cells worth of it, a corner as much as the smaller node, so between fine nodes its the same as Cell2D
+// The faces are in the order left, right, up, down and the corners after them, same as the sum of Cell2D, so level 0 gives the same bits
+void CellLOD::UpdateSteepness(const SimulationVariables& Variables, CellLOD* Nodes, LODFace* Faces, const int* NodeFaces)
+{
+	float Change = 0;
+
+	for (int i = FaceStart; i < FaceStart + FaceCount; i++)
+	{
+		LODFace& Face = Faces[NodeFaces[i]];
+		CellLOD& Other = Nodes[&Nodes[Face.A] == this ? Face.B : Face.A];
+
+		Change += GetHeightChange(Variables, Other, Face.Distance * Variables.PIPE_LENGTH) / 8 * Face.Width * Face.Width;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (Corners[i] < 0)
+			continue;
+		CellLOD& Other = Nodes[Corners[i]];
+		float Width = std::min(Size, Other.Size);
+
+		Change += GetHeightChange(Variables, Other, DiagonalMultiplier * (Size + Other.Size) / 2 * Variables.PIPE_LENGTH) / 8 * Width * Width;
+	}
+
+	Pending.TerrainHeight = TerrainHeight + Change / GetArea();
+}
@@ -0,0 +1,49 @@
+#ifndef CellLOD_HPP
+#define CellLOD_HPP
+
+#include <ostream>
+#include "Pipe.hpp"
+#include "Cell.hpp"
+
+// The shared edge between two nodes of the adaptive grid, B is in the positive x or y direction of A
+struct LODFace {
+	int A;
+	int B;
+	int Axis;			// 0 = x, 1 = y
+	float Width;		// length of the shared edge, in fine cells
+	float Distance;		// between the node centers, in fine cells
+	Pipe AB;
+	Pipe BA;
+};
+
+// A node of the adaptive grid (LODGrid2D), covers Size x Size fine cells, heights are the average over the node
+// The pipes live in the faces, since a node can have any amount of neighbours on a side
+class CellLOD : public Cell {
+	public:
+		std::pair<float, float> Velocity;
+		int Size;
+		float BaseTerrainHeight;	// TerrainHeight when the node was made from the fine cells, so the fine cells can get the change back
+		int FaceStart;				// range in the node face list of the grid
+		int FaceCount;
+		int Corners[4];				// the node past each corner (up left, up right, down left, down right), -1 if none or it doesn't have this one past one of its own
+		CellUpdate Pending;			// nodes are updated all at once, so they keep their own
+
+		CellLOD();
+		CellLOD(const CellLOD& From);
+
+		virtual ~CellLOD();
+
+		CellLOD& operator = (const CellLOD& From);
+
+		virtual float GetVelocityMagnitude() const;
+
+		float GetArea() const;
+		float GetNodeWaterForVolume(const SimulationVariables& Variables, float Volume);
+		float GetNodeSedimentForVolume(const SimulationVariables& Variables, float Volume);
+
+		void UpdatePipes(const SimulationVariables& Variables, CellLOD* Nodes, LODFace* Faces, const int* NodeFaces);
+		void UpdateWaterSurfaceAndSediment(const SimulationVariables& Variables, CellLOD* Nodes, LODFace* Faces, const int* NodeFaces);
+		void UpdateSteepness(const SimulationVariables& Variables, CellLOD* Nodes, LODFace* Faces, const int* NodeFaces);
+};
+
+#endif
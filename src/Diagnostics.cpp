@@ -0,0 +1,13 @@
+#include "Diagnostics.hpp"
+#include <ostream>
+
+std::ostream& operator << (std::ostream& Out, const Diagnostics& Stats)
+{
+	Out << "Water: " << Stats.Water.Sum << ", Sediment: " << Stats.Sediment.Sum << ", Terrain: " << Stats.Terrain.Sum
+		<< ", Sediment + Terrain: " << Stats.Sediment.Sum + Stats.Terrain.Sum << std::endl;
+	Out << "Terrain " << Stats.MinTerrain << " to " << Stats.MaxTerrain << ", max water " << Stats.MaxWater << ", max velocity " << Stats.MaxVelocity
+		<< ", " << Stats.WetCells << " of " << Stats.Cells << " cells wet, " << Stats.SteepCells << " too steep" << std::endl;
+	if (Stats.IsBlownUp())
+		Out << Stats.NaNCells << " NaN cells, " << Stats.NegativeCells << " negative cells, first at " << Stats.FirstBadCell << std::endl;
+	return Out;
+}
@@ -0,0 +1,100 @@
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "Cell.hpp"
+
+// Kahan summation, adding a million floats to one float loses most of the small ones, this doesn't
+struct KahanSum
+{
+	double Sum = 0;
+	double Compensation = 0;
+
+	void Add(double Value)
+	{
+		double Y = Value - Compensation;
+		double T = Sum + Y;
+		Compensation = (T - Sum) - Y;
+		Sum = T;
+	}
+
+	void Add(const KahanSum& Other)
+	{
+		Add(Other.Sum);
+		Add(-Other.Compensation);
+	}
+};
+
+// Totals and sanity checks of a grid, gathered while the last pass of a step walks the cells anyway
+// Every tile (or thread) fills its own, Merge adds them up in a fixed order so the result doesn't depend on the thread count
+// The volumes are sums of heights, multiply by PIPE_LENGTH^2 for the real volume
+struct Diagnostics
+{
+	static constexpr float WET_HEIGHT = 0.001f;	// cells with less water than this count as dry
+
+	KahanSum Water;
+	KahanSum Sediment;
+	KahanSum Terrain;
+	float MinTerrain = std::numeric_limits<float>::max();
+	float MaxTerrain = std::numeric_limits<float>::lowest();
+	float MaxWater = 0;
+	float MaxVelocity = 0;
+	long Cells = 0;
+	long WetCells = 0;
+	long SteepCells = 0;	// cells that were steeper than MAX_STEP against a neighbour
+	long NaNCells = 0;		// any height or the velocity is NaN or infinite
+	long NegativeCells = 0;	// water or sediment below 0
+	long FirstBadCell = -1;	// lowest index of a NaN or negative cell, -1 if there is none
+
+	void Reset() { *this = Diagnostics(); }
+
+	void Add(const Cell& Curr, float VelocityMagnitude, long Index)
+	{
+		Water.Add(Curr.WaterHeight);
+		Sediment.Add(Curr.Sediment);
+		Terrain.Add(Curr.TerrainHeight);
+		MinTerrain = std::min(MinTerrain, Curr.TerrainHeight);
+		MaxTerrain = std::max(MaxTerrain, Curr.TerrainHeight);
+		MaxWater = std::max(MaxWater, Curr.WaterHeight);
+		MaxVelocity = std::max(MaxVelocity, VelocityMagnitude);
+		Cells++;
+		WetCells += Curr.WaterHeight > WET_HEIGHT;
+
+		// One check on the sum catches a NaN or inf in any of them
+		bool NaN = !std::isfinite(Curr.WaterHeight + Curr.Sediment + Curr.TerrainHeight + VelocityMagnitude);
+		bool Negative = Curr.WaterHeight < 0 || Curr.Sediment < 0;
+		if (NaN || Negative)
+		{
+			NaNCells += NaN;
+			NegativeCells += Negative;
+			if (FirstBadCell < 0 || Index < FirstBadCell)
+				FirstBadCell = Index;
+		}
+	}
+
+	void Merge(const Diagnostics& Other)
+	{
+		Water.Add(Other.Water);
+		Sediment.Add(Other.Sediment);
+		Terrain.Add(Other.Terrain);
+		MinTerrain = std::min(MinTerrain, Other.MinTerrain);
+		MaxTerrain = std::max(MaxTerrain, Other.MaxTerrain);
+		MaxWater = std::max(MaxWater, Other.MaxWater);
+		MaxVelocity = std::max(MaxVelocity, Other.MaxVelocity);
+		Cells += Other.Cells;
+		WetCells += Other.WetCells;
+		SteepCells += Other.SteepCells;
+		NaNCells += Other.NaNCells;
+		NegativeCells += Other.NegativeCells;
+		if (FirstBadCell < 0 || (Other.FirstBadCell >= 0 && Other.FirstBadCell < FirstBadCell))
+			FirstBadCell = Other.FirstBadCell;
+	}
+
+	bool IsBlownUp() const { return NaNCells > 0 || NegativeCells > 0; }
+};
+
+std::ostream& operator << (std::ostream& Out, const Diagnostics& Stats);
+
+#endif
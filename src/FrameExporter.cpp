@@ -0,0 +1,172 @@
+#include "FrameExporter.hpp"
+#include <chrono>
+#include <cstring>
+#include <csignal>
+#include <algorithm>
+
+FrameExporter::FrameExporter(int Width, int Height, FrameFormat Format, int FramesPerSecond, int NumBuffers) : Width(Width), Height(Height), Format(Format), FramesPerSecond(FramesPerSecond), NumBuffers(std::max(1, NumBuffers)), File(nullptr), IsPipe(false), Colored(false), ColoredMin(0), ColoredMax(0), FullStart(0), FullCount(0), Closing(false), FrameCount(0), WaitSeconds(0), Failed(false)
+{
+	for (int i = 0; i < this->NumBuffers; i++)
+	{
+		Buffers.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[Width * Height * 4]));
+		Free.push_back(i);
+	}
+	Full.reset(new int[this->NumBuffers]);
+	Colors.reset(new unsigned char[Width * Height * 4]);
+	if (Format == FrameFormat::Y4M)
+		Planes.reset(new unsigned char[Width * Height * 3]);
+}
+
+FrameExporter::~FrameExporter()
+{
+	Close();
+}
+
+bool FrameExporter::Open(const char* Path)
+{
+	if (std::strcmp(Path, "-") == 0)
+		File = stdout;
+	else if (Path[0] == '|')
+	{
+		// If the command exits early the write should fail, not kill the whole program
+		std::signal(SIGPIPE, SIG_IGN);
+		File = popen(Path + 1, "w");
+		IsPipe = true;
+	}
+	else
+		File = std::fopen(Path, "wb");
+	if (!File)
+		return false;
+
+	if (Format == FrameFormat::Y4M)
+		std::fprintf(File, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", Width, Height, FramesPerSecond);
+
+	Closing = false;
+	Writer = std::thread([this]() { WriterLoop(); });
+	return true;
+}
+
+void FrameExporter::Submit(const Cell2D* Cells, float Min, float Max, const uint8_t* ChangedRows)
+{
+	if (!File || Failed)
+		return;
+
+	// A new range changes every pixel
+	bool ColorAll = !ChangedRows || !Colored || Min != ColoredMin || Max != ColoredMax;
+	for (int y = 0; y < Height; y++)
+	{
+		if (!ColorAll && !ChangedRows[y])
+			continue;
+		for (int i = y * Width; i < (y + 1) * Width; i++)
+		{
+			int Color = Cells[i].GetColor(Min, Max);
+			Colors[i * 4 + 0] = Color >> 24;
+			Colors[i * 4 + 1] = Color >> 16;
+			Colors[i * 4 + 2] = Color >> 8;
+			Colors[i * 4 + 3] = Color;
+		}
+	}
+	Colored = true;
+	ColoredMin = Min;
+	ColoredMax = Max;
+
+	int Buffer;
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		if (Free.empty())
+		{
+			auto StartTime = std::chrono::steady_clock::now();
+			FreeCondition.wait(Lock, [this]() { return !Free.empty(); });
+			WaitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+		}
+		Buffer = Free.back();
+		Free.pop_back();
+	}
+
+	std::memcpy(Buffers[Buffer].get(), Colors.get(), Width * Height * 4);
+
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Full[(FullStart + FullCount) % NumBuffers] = Buffer;
+		FullCount++;
+		FrameCount++;
+	}
+	FullCondition.notify_one();
+}
+
+void FrameExporter::Close()
+{
+	if (!File)
+		return;
+
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Closing = true;
+	}
+	FullCondition.notify_one();
+	Writer.join();
+
+	if (IsPipe)
+		pclose(File);
+	else if (File == stdout)
+		std::fflush(File);
+	else
+		std::fclose(File);
+	File = nullptr;
+	IsPipe = false;
+}
+
+long FrameExporter::GetFrameCount() const { return FrameCount; }
+double FrameExporter::GetWaitSeconds() const { return WaitSeconds; }
+bool FrameExporter::HasFailed() const { return Failed; }
+
+// Takes the frames in the order they were submitted, until Close and there are none left
+void FrameExporter::WriterLoop()
+{
+	while (true)
+	{
+		int Buffer;
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			FullCondition.wait(Lock, [this]() { return FullCount > 0 || Closing; });
+			if (FullCount == 0)
+				return;
+			Buffer = Full[FullStart];
+			FullStart = (FullStart + 1) % NumBuffers;
+			FullCount--;
+		}
+
+		// After a failed write the buffers still have to come back, or Submit would wait forever
+		if (!Failed)
+			Failed = !WriteFrame(Buffers[Buffer].get());
+
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			Free.push_back(Buffer);
+		}
+		FreeCondition.notify_one();
+	}
+}
+
+// BT.601 limited range, in integers, same as most encoders expect for video that doesn't say otherwise
+bool FrameExporter::WriteFrame(const unsigned char* Pixels)
+{
+	int Count = Width * Height;
+	if (Format == FrameFormat::RGBA)
+		return std::fwrite(Pixels, 4, Count, File) == (size_t)Count;
+
+	unsigned char* Y = Planes.get();
+	unsigned char* U = Y + Count;
+	unsigned char* V = U + Count;
+	for (int i = 0; i < Count; i++)
+	{
+		int R = Pixels[i * 4 + 0];
+		int G = Pixels[i * 4 + 1];
+		int B = Pixels[i * 4 + 2];
+		Y[i] = ((66 * R + 129 * G + 25 * B + 128) >> 8) + 16;
+		U[i] = ((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128;
+		V[i] = ((112 * R - 94 * G - 18 * B + 128) >> 8) + 128;
+	}
+
+	return std::fputs("FRAME\n", File) >= 0 && std::fwrite(Planes.get(), 1, Count * 3, File) == (size_t)Count * 3;
+}
@@ -0,0 +1,85 @@
+#ifndef FRAMEEXPORTER_HPP
+#define FRAMEEXPORTER_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Cell2D.hpp"
+
+enum class FrameFormat {
+	Y4M,	// YUV4MPEG2 4:4:4, ffmpeg and most players read it from a pipe without being told the size
+	RGBA	// raw 8 bit RGBA, the frames one after the other, the reader has to know the size
+};
+
+// Writes pictures of a grid (Cell2D::GetColor) to a file, to stdout ("-") or to the stdin of a command ("|ffmpeg ..."), on its own thread
+// Submit only colors the cells into a free buffer, the thread converts and writes it, so a slow encoder costs the solver nothing
+// until all the buffers are waiting to be written, then Submit waits for one instead of the frames piling up
+// The last colored frame is kept, so with the rows that changed since the last Submit only those have to be colored again
+class FrameExporter {
+	public:
+		FrameExporter(int Width, int Height, FrameFormat Format, int FramesPerSecond = 30, int NumBuffers = 4);
+		FrameExporter(const FrameExporter& From) = delete;
+
+		~FrameExporter();
+
+		FrameExporter& operator = (const FrameExporter& From) = delete;
+
+		// Returns false if it can't be opened
+		bool Open(const char* Path);
+		// Cells is Width x Height, Min and Max are the terrain heights that go from black to white
+		// ChangedRows has a byte per row, not 0 if a cell in it changed, nullptr colors all of them
+		void Submit(const Cell2D* Cells, float Min, float Max, const uint8_t* ChangedRows = nullptr);
+		// Writes what is left and closes the file, or waits for the command to exit
+		void Close();
+
+		long GetFrameCount() const;
+		// How long Submit waited for a free buffer, in total
+		double GetWaitSeconds() const;
+		// A write failed (the command exited), the frames after it are dropped
+		bool HasFailed() const;
+
+	private:
+		const int Width;
+		const int Height;
+		const FrameFormat Format;
+		const int FramesPerSecond;
+		const int NumBuffers;
+
+		std::FILE* File;
+		bool IsPipe;
+		std::thread Writer;
+
+		// The buffers are RGBA, Planes is where the writer turns one into Y4M
+		std::vector<std::unique_ptr<unsigned char[]>> Buffers;
+		std::unique_ptr<unsigned char[]> Planes;
+
+		// The last frame Submit colored, and with which range, only Submit uses it
+		std::unique_ptr<unsigned char[]> Colors;
+		bool Colored;
+		float ColoredMin;
+		float ColoredMax;
+
+		// Indices of the buffers, the free ones, and the ones waiting to be written in order, as a ring
+		std::mutex Mutex;
+		std::condition_variable FreeCondition;
+		std::condition_variable FullCondition;
+		std::vector<int> Free;
+		std::unique_ptr<int[]> Full;
+		int FullStart;
+		int FullCount;
+		bool Closing;
+
+		long FrameCount;
+		double WaitSeconds;
+		std::atomic_bool Failed;
+
+		void WriterLoop();
+		bool WriteFrame(const unsigned char* Pixels);
+};
+
+#endif
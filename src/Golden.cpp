@@ -0,0 +1,666 @@
+#include "Golden.hpp"
+#include "Cell1D.hpp"
+#include "Cell2D.hpp"
+#include "World2D.hpp"
+#include "Diagnostics.hpp"
+#include "LODGrid2D.hpp"
+#include "Allocations.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+struct GoldenScenario
+{
+	const char* Name;
+	int SizeX;
+	int SizeY;	// 1 for a 1D one
+	int Steps;
+	BoundaryPolicy Boundary;
+	SedimentTransport Transport;
+	bool Rain;	// without rain there is no evaporation either, so a closed grid has to keep its water
+	double MaxOutliers;	// share of the cells of a field that can be out of tolerance, see OUTLIER_SCALE
+	float Ripples;	// height of the ripples of the 2D terrain, at 3 they are steeper than MAX_STEP so the terrain slumps
+};
+
+// The 1D ones don't rain, Cell1D::UpdateCells rains with std::rand
+// Erosion switches between dissolving and depositing, which is where rounding grows fastest, the traced ones move sediment
+// into cells that switch more often, they run for fewer steps so a rounding change stays in tolerance
+// The limiter of MacCormack picks one of two values, rounding can flip that for a few cells, only those get outliers
+// The closed ones without rain with Flux are what the baseline solver can run, they also have a reference from it (see HasBaseline)
+static const GoldenScenario Scenarios[] = {
+	{ "1d-closed", 128, 1, 2000, BoundaryPolicy::Closed, SedimentTransport::Flux, false, 0, 0 },
+	{ "1d-periodic-maccormack", 128, 1, 500, BoundaryPolicy::Periodic, SedimentTransport::MacCormack, false, 0.01, 0 },
+	{ "2d-closed", 96, 96, 300, BoundaryPolicy::Closed, SedimentTransport::Flux, false, 0, 1 },
+	{ "2d-closed-steep", 64, 64, 200, BoundaryPolicy::Closed, SedimentTransport::Flux, false, 0, 3 },
+	{ "2d-open-semi-lagrangian", 96, 96, 100, BoundaryPolicy::Open, SedimentTransport::SemiLagrangian, true, 0, 1 },
+	{ "2d-periodic-maccormack", 96, 96, 100, BoundaryPolicy::Periodic, SedimentTransport::MacCormack, true, 0.01, 1 }
+};
+
+// A value is fine if its within any of the three, the absolute one (the scenarios have a PIPE_LENGTH of 1) is for cells that are about 0,
+// where the other two are meaningless
+// Rounding differently (FMA, another order of the sums) grows a bit every step, these let it grow for the steps of the scenarios, a change to the physics doesn't fit
+struct GoldenField
+{
+	const char* Name;
+	int64_t MaxUlp;
+	float MaxRelative;
+	float MaxAbsolute;
+};
+
+static const GoldenField Fields[] = {
+	{ "terrain", 64, 1e-4f, 1e-4f },
+	{ "water", 64, 1e-3f, 1e-4f },
+	{ "sediment", 64, 1e-3f, 1e-5f },
+	{ "velocity x", 64, 1e-2f, 1e-3f },
+	{ "velocity y", 64, 1e-2f, 1e-3f }
+};
+
+// An outlier still has to be within this many times the tolerances, a flipped limiter is a small step, a broken cell isn't
+static const float OUTLIER_SCALE = 20;
+
+// Of the totals at the start, the clamp of negative heights to 0 makes a little water and sediment
+static const double CONSERVATION_TOLERANCE = 1e-4;
+
+struct GoldenRun
+{
+	int NumFields = 0;
+	std::vector<float> Values;	// field after field, SizeX * SizeY each, ghosts included
+	Diagnostics Start;
+	Diagnostics End;
+	bool BlownUp = false;
+};
+
+static SimulationVariables GetVariables(const GoldenScenario& Scenario)
+{
+	SimulationVariables Variables;
+	Variables.DT /= 2;
+	Variables.RAINFALL = Scenario.Rain ? Variables.RAINFALL / 20 : 0;
+	Variables.EVAPORATION = Scenario.Rain ? Variables.EVAPORATION : 0;
+	Variables.Boundary = Scenario.Boundary;
+	Variables.Transport = Scenario.Transport;
+	return Variables;
+}
+
+template<class T>
+static Diagnostics GetInteriorTotals(const T* Cells, int SizeX, int SizeY)
+{
+	Diagnostics Stats;
+	for (int y = SizeY == 1 ? 0 : 1; y < (SizeY == 1 ? 1 : SizeY - 1); y++)
+		for (int x = 1; x < SizeX - 1; x++)
+		{
+			int i = x + y * SizeX;
+			Stats.Add(Cells[i], Cells[i].T::GetVelocityMagnitude(), i);
+		}
+	return Stats;
+}
+
+// Same valley as the 1D test in main, with a wall in the middle and a column of water on the right
+static GoldenRun Run1D(const GoldenScenario& Scenario)
+{
+	SimulationVariables Variables = GetVariables(Scenario);
+	int Size = Scenario.SizeX;
+	std::vector<Cell1D> Cells(Size);
+	std::vector<float> Scratch(Cell1D::GetScratchSize(Size));
+
+	for (int i = 0; i < Size; i++)
+	{
+		int Offset = std::abs(i - Size / 2);
+		Cells[i].TerrainHeight = Offset * Offset * Variables.PIPE_LENGTH / (Size * Size / 4) * 32;
+	}
+	Cells[Size / 2].TerrainHeight += Variables.PIPE_LENGTH * 8;
+	Cells[Size / 2 - 1].TerrainHeight += Variables.PIPE_LENGTH * 9;
+	Cells[Size / 2 - 2].TerrainHeight += Variables.PIPE_LENGTH * 10;
+	Cells[Size - 2].WaterHeight = Variables.PIPE_LENGTH * 96;
+
+	GoldenRun Run;
+	Run.Start = GetInteriorTotals(Cells.data(), Size, 1);
+	for (int i = 0; i < Scenario.Steps; i++)
+		Cell1D::UpdateCells(Variables, Cells.data(), Size, Scratch.data());
+	Run.End = GetInteriorTotals(Cells.data(), Size, 1);
+	Run.BlownUp = Run.End.IsBlownUp();
+
+	Run.NumFields = 4;
+	for (int i = 0; i < Size; i++)
+		Run.Values.push_back(Cells[i].TerrainHeight);
+	for (int i = 0; i < Size; i++)
+		Run.Values.push_back(Cells[i].WaterHeight);
+	for (int i = 0; i < Size; i++)
+		Run.Values.push_back(Cells[i].Sediment);
+	for (int i = 0; i < Size; i++)
+		Run.Values.push_back(Cells[i].Velocity);
+	return Run;
+}
+
+// A bowl with ripples in it, and a lake in one corner that has to find its way down
+static GoldenRun Run2D(const GoldenScenario& Scenario)
+{
+	SimulationVariables Variables = GetVariables(Scenario);
+	int SizeX = Scenario.SizeX;
+	int SizeY = Scenario.SizeY;
+	std::vector<Cell2D> Cells(SizeX * SizeY);
+
+	for (int y = 0; y < SizeY; y++)
+		for (int x = 0; x < SizeX; x++)
+		{
+			Cell2D& Curr = Cells[x + y * SizeX];
+			float OX = x - SizeX / 2.0f;
+			float OY = y - SizeY / 2.0f;
+			Curr.TerrainHeight = (OX * OX + OY * OY) / SizeX * Variables.PIPE_LENGTH / 2 + Variables.PIPE_LENGTH * Scenario.Ripples * std::sin(x * 0.7f) * std::cos(y * 0.45f);
+			if (x < SizeX / 3 && y < SizeY / 3)
+				Curr.WaterHeight = Variables.PIPE_LENGTH * 4;
+		}
+
+	GoldenRun Run;
+	Run.Start = GetInteriorTotals(Cells.data(), SizeX, SizeY);
+	World2D World(Cells.data(), SizeX, SizeY);
+	Run.BlownUp = !World.UpdateCells(Variables, Scenario.Steps);
+	Run.End = GetInteriorTotals(Cells.data(), SizeX, SizeY);
+
+	Run.NumFields = 5;
+	for (size_t i = 0; i < Cells.size(); i++)
+		Run.Values.push_back(Cells[i].TerrainHeight);
+	for (size_t i = 0; i < Cells.size(); i++)
+		Run.Values.push_back(Cells[i].WaterHeight);
+	for (size_t i = 0; i < Cells.size(); i++)
+		Run.Values.push_back(Cells[i].Sediment);
+	for (size_t i = 0; i < Cells.size(); i++)
+		Run.Values.push_back(Cells[i].Velocity.first);
+	for (size_t i = 0; i < Cells.size(); i++)
+		Run.Values.push_back(Cells[i].Velocity.second);
+	return Run;
+}
+
+static GoldenRun RunScenario(const GoldenScenario& Scenario)
+{
+	return Scenario.SizeY == 1 ? Run1D(Scenario) : Run2D(Scenario);
+}
+
+// Water that flows the same everywhere has to carry its sediment as far with every transport, they only smear it differently
+// Flat terrain, a flat surface and the same flux in every right pipe keep the flow as it is, erosion and deposition are off
+// The water is shallow, so a transport that moves the sediment by the flux instead of the flux over the depth is a lot slower
+static const float TRANSPORT_DEPTH = 0.25f;
+static const float TRANSPORT_CELLS_PER_STEP = 0.2f;
+static const int TRANSPORT_STEPS = 50;
+// Of the distance, moving by the flux instead of the flux over the depth would be 4 times off
+static const double TRANSPORT_TOLERANCE = 0.02;
+// MacCormack can only fall behind: where the stripe is too sharp its limiter keeps the plain trace, which isn't conservative,
+// the 4 cell stripe ends up 0.9 of a cell back after the 50 steps (without the limiter it moves the full 10, smoother stripes lag less)
+// Ahead of the flow it gets the same TRANSPORT_TOLERANCE as the others
+static const double MACCORMACK_LAG = 0.1;
+
+static SimulationVariables GetTransportVariables(SedimentTransport Transport)
+{
+	SimulationVariables Variables;
+	Variables.DT /= 2;
+	Variables.RAINFALL = 0;
+	Variables.EVAPORATION = 0;
+	Variables.DISSOLVE_CONSTANT = 0;
+	Variables.DEPOSITION_CONSTANT = 0;
+	Variables.Boundary = BoundaryPolicy::Periodic;
+	Variables.Transport = Transport;
+	return Variables;
+}
+
+// A stripe of sediment, the water is less where it is so the liquid height stays the same
+template<class T>
+static void SetupTransport(const SimulationVariables& Variables, T& Curr, int x, float& Flux)
+{
+	Flux = TRANSPORT_CELLS_PER_STEP * TRANSPORT_DEPTH * Variables.PIPE_LENGTH * Variables.PIPE_LENGTH / Variables.DT;
+	Curr.Sediment = x >= 16 && x < 20 ? TRANSPORT_DEPTH / 10 : 0;
+	Curr.WaterHeight = TRANSPORT_DEPTH - Curr.Sediment;
+	Curr.Right.FlowVolume = Flux;
+}
+
+template<class T>
+static double GetSedimentCenter(const T* Cells, int SizeX, int y)
+{
+	double Sum = 0;
+	double Moment = 0;
+	for (int x = 1; x < SizeX - 1; x++)
+	{
+		Sum += Cells[x + y * SizeX].Sediment;
+		Moment += (double)x * Cells[x + y * SizeX].Sediment;
+	}
+	return Moment / Sum;
+}
+
+// How many cells the center of the sediment moved
+static double GetTransportDistance1D(SedimentTransport Transport)
+{
+	SimulationVariables Variables = GetTransportVariables(Transport);
+	int Size = 96;
+	std::vector<Cell1D> Cells(Size);
+	std::vector<float> Scratch(Cell1D::GetScratchSize(Size));
+	for (int x = 0; x < Size; x++)
+		SetupTransport(Variables, Cells[x], x, Cells[x].Velocity);
+
+	double Start = GetSedimentCenter(Cells.data(), Size, 0);
+	for (int i = 0; i < TRANSPORT_STEPS; i++)
+		Cell1D::UpdateCells(Variables, Cells.data(), Size, Scratch.data());
+	return GetSedimentCenter(Cells.data(), Size, 0) - Start;
+}
+
+static double GetTransportDistance2D(SedimentTransport Transport)
+{
+	SimulationVariables Variables = GetTransportVariables(Transport);
+	int SizeX = 96;
+	int SizeY = 12;
+	std::vector<Cell2D> Cells(SizeX * SizeY);
+	for (int y = 0; y < SizeY; y++)
+		for (int x = 0; x < SizeX; x++)
+		{
+			Cell2D& Curr = Cells[x + y * SizeX];
+			SetupTransport(Variables, Curr, x, Curr.Velocity.first);
+		}
+
+	double Start = GetSedimentCenter(Cells.data(), SizeX, SizeY / 2);
+	World2D World(Cells.data(), SizeX, SizeY);
+	World.UpdateCells(Variables, TRANSPORT_STEPS);
+	return GetSedimentCenter(Cells.data(), SizeX, SizeY / 2) - Start;
+}
+
+// Returns the number of transports that moved the sediment a different distance than the flow did
+static int CheckTransport()
+{
+	const SedimentTransport Transports[] = { SedimentTransport::Flux, SedimentTransport::SemiLagrangian, SedimentTransport::MacCormack };
+	const char* const Names[] = { "flux", "semi-lagrangian", "maccormack" };
+	double Expected = TRANSPORT_CELLS_PER_STEP * TRANSPORT_STEPS;
+
+	int Failed = 0;
+	std::cout << "transport, " << Expected << " cells:" << std::endl;
+	for (int t = 0; t < 3; t++)
+	{
+		double Distances[] = { GetTransportDistance1D(Transports[t]), GetTransportDistance2D(Transports[t]) };
+		for (int d = 0; d < 2; d++)
+		{
+			double Lag = Transports[t] == SedimentTransport::MacCormack ? MACCORMACK_LAG : TRANSPORT_TOLERANCE;
+			bool Fine = Distances[d] >= Expected * (1 - Lag) && Distances[d] <= Expected * (1 + TRANSPORT_TOLERANCE);
+			std::cout << "  " << Names[t] << " " << d + 1 << "d: " << Distances[d] << (Fine ? "" : ", FAIL") << std::endl;
+			Failed += !Fine;
+		}
+	}
+	return Failed;
+}
+
+// A dry grid with slopes steeper than MAX_STEP, so only UpdateSteepness changes anything
+// With every block at level 0 the adaptive grid has to slump it to the same bits as the World, it rebuilds a few times on the way
+static const int LOD_STEEPNESS_STEPS = 60;
+
+static int CheckLODSteepness()
+{
+	SimulationVariables Variables;
+	Variables.RAINFALL = 0;
+	Variables.LOD_MAX_LEVEL = 0;
+	int SizeX = 50;
+	int SizeY = 37;
+	std::vector<Cell2D> Cells(SizeX * SizeY);
+	for (int y = 0; y < SizeY; y++)
+		for (int x = 0; x < SizeX; x++)
+			Cells[x + y * SizeX].TerrainHeight = 4 + std::sin(x * 1.3f) * std::cos(y * 0.9f) * 3 + x * 0.2f;
+	std::vector<Cell2D> Start(Cells);
+	std::vector<Cell2D> LODCells(Cells);
+
+	World2D World(Cells.data(), SizeX, SizeY);
+	World.UpdateCells(Variables, LOD_STEEPNESS_STEPS);
+	LODGrid2D LOD(LODCells.data(), SizeX, SizeY);
+	for (int i = 0; i < LOD_STEEPNESS_STEPS; i++)
+		LOD.UpdateCells(Variables);
+	LOD.WriteBack();
+
+	// If nothing slumped there is nothing to compare
+	int Differ = 0;
+	int Slumped = 0;
+	for (int y = 1; y < SizeY - 1; y++)
+		for (int x = 1; x < SizeX - 1; x++)
+		{
+			int i = x + y * SizeX;
+			Differ += std::memcmp(&Cells[i].TerrainHeight, &LODCells[i].TerrainHeight, sizeof(float)) != 0;
+			Slumped += Cells[i].TerrainHeight != Start[i].TerrainHeight;
+		}
+	bool Fine = Differ == 0 && Slumped > 0;
+	std::cout << "lod steepness at level 0: " << Differ << " of " << (SizeX - 2) * (SizeY - 2) << " cells differ from the world, " << Slumped << " slumped" << (Fine ? "" : ", FAIL") << std::endl;
+	return !Fine;
+}
+
+// Once warmed up a step never allocates, the first steps can, for the buffers that are only made once
+// Every step queues a brush and there is a spring, so the edits and the rain are stepped as well, the LOD grid rebuilds twice
+static const int ALLOCATION_WARMUP_STEPS = 5;
+static const int ALLOCATION_STEPS = 40;
+
+static void SetupAllocations(std::vector<Cell2D>& Cells, int Size)
+{
+	for (int y = 0; y < Size; y++)
+		for (int x = 0; x < Size; x++)
+		{
+			Cell2D& Curr = Cells[x + y * Size];
+			Curr.TerrainHeight = 4 + std::sin(x * 0.7f) * std::cos(y * 0.45f) + x * 0.05f;
+			Curr.WaterHeight = x < Size / 3 ? 2 : 0;
+		}
+}
+
+// Returns the allocations of the steps after the warmup
+static size_t CountWorldAllocations(SedimentTransport Transport, bool Barrier)
+{
+	SimulationVariables Variables = GetTransportVariables(Transport);
+	Variables.RAINFALL = SimulationVariables().RAINFALL;
+	Variables.DISSOLVE_CONSTANT = SimulationVariables().DISSOLVE_CONSTANT;
+	Variables.DEPOSITION_CONSTANT = SimulationVariables().DEPOSITION_CONSTANT;
+	int Size = 64;
+	std::vector<Cell2D> Cells(Size * Size);
+	SetupAllocations(Cells, Size);
+
+	World2D World(Cells.data(), Size, Size);
+	World.AddSpring(Size / 2, Size / 2, 1);
+	BrushCommand Brush = { BrushTool::Terrain, Size / 2, Size / 2, 4, 1, true, false };
+	size_t Start = 0;
+	for (int i = 0; i < ALLOCATION_WARMUP_STEPS + ALLOCATION_STEPS; i++)
+	{
+		if (i == ALLOCATION_WARMUP_STEPS)
+			Start = GetAllocationCount();
+		World.QueueBrush(Brush);
+		if (Barrier)
+			World.UpdateCellsBarrier(Variables);
+		else
+			World.UpdateCells(Variables);
+	}
+	return GetAllocationCount() - Start;
+}
+
+static size_t CountLODAllocations()
+{
+	SimulationVariables Variables;
+	Variables.DT /= 2;
+	int Size = 66;
+	std::vector<Cell2D> Cells(Size * Size);
+	SetupAllocations(Cells, Size);
+
+	LODGrid2D LOD(Cells.data(), Size, Size);
+	LOD.Rebuild(Variables);
+	size_t Start = 0;
+	for (int i = 0; i < ALLOCATION_WARMUP_STEPS + ALLOCATION_STEPS; i++)
+	{
+		if (i == ALLOCATION_WARMUP_STEPS)
+			Start = GetAllocationCount();
+		LOD.UpdateCells(Variables);
+	}
+	LOD.WriteBack();
+	return GetAllocationCount() - Start;
+}
+
+static size_t Count1DAllocations()
+{
+	SimulationVariables Variables;
+	Variables.DT /= 2;
+	Variables.Transport = SedimentTransport::MacCormack;
+	int Size = 128;
+	std::vector<Cell1D> Cells(Size);
+	std::vector<float> Scratch(Cell1D::GetScratchSize(Size));
+	for (int x = 0; x < Size; x++)
+	{
+		Cells[x].TerrainHeight = 4 + std::sin(x * 0.7f) + x * 0.05f;
+		Cells[x].WaterHeight = x < Size / 3 ? 2 : 0;
+	}
+
+	size_t Start = 0;
+	for (int i = 0; i < ALLOCATION_WARMUP_STEPS + ALLOCATION_STEPS; i++)
+	{
+		if (i == ALLOCATION_WARMUP_STEPS)
+			Start = GetAllocationCount();
+		Cell1D::UpdateCells(Variables, Cells.data(), Size, Scratch.data());
+	}
+	return GetAllocationCount() - Start;
+}
+
+// Returns the number of solvers that allocated after the warmup
+static int CheckAllocations()
+{
+	const SedimentTransport Transports[] = { SedimentTransport::Flux, SedimentTransport::SemiLagrangian, SedimentTransport::MacCormack };
+	const char* const Names[] = { "flux", "semi-lagrangian", "maccormack" };
+
+	std::vector<std::string> Solvers;
+	std::vector<size_t> Counts;
+	for (int t = 0; t < 3; t++)
+		for (int Barrier = 0; Barrier < 2; Barrier++)
+		{
+			Solvers.push_back(std::string("2d ") + Names[t] + (Barrier ? " barrier" : " graph"));
+			Counts.push_back(CountWorldAllocations(Transports[t], Barrier));
+		}
+	Solvers.push_back("lod");
+	Counts.push_back(CountLODAllocations());
+	Solvers.push_back("1d");
+	Counts.push_back(Count1DAllocations());
+
+	int Failed = 0;
+	std::cout << "allocations in " << ALLOCATION_STEPS << " steps after the warmup:" << std::endl;
+	for (size_t i = 0; i < Solvers.size(); i++)
+	{
+		std::cout << "  " << Solvers[i] << ": " << Counts[i] << (Counts[i] ? ", FAIL" : "") << std::endl;
+		Failed += Counts[i] != 0;
+	}
+	return Failed;
+}
+
+// What the solver of the baseline commit can run, golden/baseline/Record.cpp records those (make golden-baseline)
+static bool HasBaseline(const GoldenScenario& Scenario)
+{
+	return Scenario.Boundary == BoundaryPolicy::Closed && Scenario.Transport == SedimentTransport::Flux && !Scenario.Rain;
+}
+
+static std::string GetPath(const char* Directory, const GoldenScenario& Scenario)
+{
+	return std::string(Directory) + "/" + Scenario.Name + ".golden";
+}
+
+// golden <SizeX> <SizeY> <Steps> <NumFields>, then the fields one after the other, a row of SizeX values per line
+// 9 significant digits are enough to get the same float back, so the text is exact and reads the same on any machine
+static bool Save(const std::string& Path, const GoldenScenario& Scenario, const GoldenRun& Run)
+{
+	std::FILE* File = std::fopen(Path.c_str(), "w");
+	if (!File)
+		return false;
+	std::fprintf(File, "golden %d %d %d %d\n", Scenario.SizeX, Scenario.SizeY, Scenario.Steps, Run.NumFields);
+	for (size_t i = 0; i < Run.Values.size(); i++)
+		std::fprintf(File, "%.9g%c", Run.Values[i], (i + 1) % Scenario.SizeX == 0 ? '\n' : ' ');
+	return std::fclose(File) == 0;
+}
+
+static bool Load(const std::string& Path, const GoldenScenario& Scenario, const GoldenRun& Run, std::vector<float>& Out)
+{
+	std::ifstream File(Path);
+	std::string Word;
+	int SizeX, SizeY, Steps, NumFields;
+	if (!(File >> Word >> SizeX >> SizeY >> Steps >> NumFields) || Word != "golden")
+		return false;
+	if (SizeX != Scenario.SizeX || SizeY != Scenario.SizeY || Steps != Scenario.Steps || NumFields != Run.NumFields)
+		return false;
+
+	// strtof and not >>, that one fails on the denormals a field can have
+	Out.resize(Run.Values.size());
+	for (float& Value : Out)
+	{
+		if (!(File >> Word))
+			return false;
+		char* End;
+		Value = std::strtof(Word.c_str(), &End);
+		if (*End != '\0')
+			return false;
+	}
+	return true;
+}
+
+// How many floats are between the two, the sign bit is flipped into an order so the distance goes across 0 as well
+static int64_t GetUlpDistance(float A, float B)
+{
+	int32_t IA, IB;
+	std::memcpy(&IA, &A, sizeof(float));
+	std::memcpy(&IB, &B, sizeof(float));
+	if (IA < 0)
+		IA = INT32_MIN - IA;
+	if (IB < 0)
+		IB = INT32_MIN - IB;
+	return std::abs((int64_t)IA - IB);
+}
+
+struct FieldError
+{
+	long Differ = 0;			// cells that aren't the same bits
+	long OutOfTolerance = 0;
+	int64_t MaxUlp = 0;
+	long MaxUlpIndex = -1;
+	float MaxRelative = 0;
+	long MaxRelativeIndex = -1;
+	long TooFar = 0;			// out of OUTLIER_SCALE times the tolerances
+	float MaxOutOfTolerance = 0;	// absolute, of the cells that are out of tolerance
+	long MaxOutOfToleranceIndex = -1;
+};
+
+static FieldError Compare(const GoldenField& Field, const float* Expected, const float* Actual, long Count, bool Exact)
+{
+	FieldError Error;
+	for (long i = 0; i < Count; i++)
+	{
+		if (std::memcmp(&Expected[i], &Actual[i], sizeof(float)) == 0)
+			continue;
+		Error.Differ++;
+
+		float Absolute = std::abs(Expected[i] - Actual[i]);
+		float Relative = Absolute == 0 ? 0 : Absolute / std::max(std::abs(Expected[i]), std::abs(Actual[i]));	// 0 and -0
+		int64_t Ulp = GetUlpDistance(Expected[i], Actual[i]);
+		if (Ulp > Error.MaxUlp)
+		{
+			Error.MaxUlp = Ulp;
+			Error.MaxUlpIndex = i;
+		}
+		if (Relative > Error.MaxRelative)
+		{
+			Error.MaxRelative = Relative;
+			Error.MaxRelativeIndex = i;
+		}
+
+		// Written so a NaN is never within
+		bool Within = Ulp <= Field.MaxUlp || Relative <= Field.MaxRelative || Absolute <= Field.MaxAbsolute;
+		if (Within && !Exact)
+			continue;
+		Error.OutOfTolerance++;
+		if (!(Ulp <= Field.MaxUlp * OUTLIER_SCALE || Relative <= Field.MaxRelative * OUTLIER_SCALE || Absolute <= Field.MaxAbsolute * OUTLIER_SCALE))
+			Error.TooFar++;
+		if (!(Absolute <= Error.MaxOutOfTolerance))
+		{
+			Error.MaxOutOfTolerance = Absolute;
+			Error.MaxOutOfToleranceIndex = i;
+		}
+	}
+	return Error;
+}
+
+static void PrintCell(const GoldenScenario& Scenario, const float* Expected, const float* Actual, long Index)
+{
+	if (Index < 0)
+		return;
+	std::cout << " at (" << Index % Scenario.SizeX << ", " << Index / Scenario.SizeX << "), " << Actual[Index] << " instead of " << Expected[Index];
+}
+
+// Returns true if the total is still the same
+static bool CheckTotal(const char* Name, double Start, double End)
+{
+	double Change = std::abs(End - Start) / std::max(std::abs(Start), 1e-30);
+	if (Change <= CONSERVATION_TOLERANCE)
+		return true;
+	std::cout << "  " << Name << " total went from " << Start << " to " << End << ", " << Change << " of it" << std::endl;
+	return false;
+}
+
+int RecordGolden(const char* Directory)
+{
+	int Failed = 0;
+	for (const GoldenScenario& Scenario : Scenarios)
+	{
+		GoldenRun Run = RunScenario(Scenario);
+		std::string Path = GetPath(Directory, Scenario);
+		if (Run.BlownUp)
+			std::cout << Scenario.Name << ": blew up, not saved" << std::endl;
+		else if (!Save(Path, Scenario, Run))
+			std::cout << Scenario.Name << ": can't write " << Path << std::endl;
+		else
+		{
+			std::cout << Scenario.Name << ": saved to " << Path << std::endl;
+			continue;
+		}
+		Failed++;
+	}
+	return Failed;
+}
+
+// Prints what differs, Label goes in front of the fields, Remake is the make target that writes Path
+static bool CheckFields(const GoldenScenario& Scenario, const GoldenRun& Run, const std::string& Path, const char* Label, const char* Remake, bool Exact)
+{
+	std::vector<float> Expected;
+	if (!Load(Path, Scenario, Run, Expected))
+	{
+		std::cout << "  " << Label << Path << " is missing or from another scenario, make " << Remake << " writes it" << std::endl;
+		return false;
+	}
+
+	bool Fine = true;
+	long Count = (long)Scenario.SizeX * Scenario.SizeY;
+	for (int f = 0; f < Run.NumFields; f++)
+	{
+		const float* ExpectedField = Expected.data() + f * Count;
+		const float* ActualField = Run.Values.data() + f * Count;
+		FieldError Error = Compare(Fields[f], ExpectedField, ActualField, Count, Exact);
+		if (Error.Differ == 0)
+			continue;
+
+		std::cout << "  " << Label << Fields[f].Name << ": " << Error.Differ << " of " << Count << " cells differ, " << Error.OutOfTolerance << " by too much, " << Error.TooFar << " by " << OUTLIER_SCALE << " times that" << std::endl;
+		std::cout << "    max " << Error.MaxUlp << " ulp";
+		PrintCell(Scenario, ExpectedField, ActualField, Error.MaxUlpIndex);
+		std::cout << std::endl << "    max " << Error.MaxRelative << " relative";
+		PrintCell(Scenario, ExpectedField, ActualField, Error.MaxRelativeIndex);
+		std::cout << std::endl;
+		if (Error.OutOfTolerance > 0)
+		{
+			std::cout << "    max " << Error.MaxOutOfTolerance << " out of tolerance";
+			PrintCell(Scenario, ExpectedField, ActualField, Error.MaxOutOfToleranceIndex);
+			std::cout << std::endl;
+		}
+		Fine &= Exact ? Error.OutOfTolerance == 0 : Error.OutOfTolerance <= Count * Scenario.MaxOutliers && Error.TooFar == 0;
+	}
+	return Fine;
+}
+
+int CheckGolden(const char* Directory, bool Exact)
+{
+	int Failed = 0;
+	std::cout.precision(9);
+	for (const GoldenScenario& Scenario : Scenarios)
+	{
+		GoldenRun Run = RunScenario(Scenario);
+		std::cout << Scenario.Name << ":" << std::endl;
+		bool Fine = !Run.BlownUp;
+		if (Run.BlownUp)
+			std::cout << "  blew up" << std::endl;
+
+		// The invariants hold whatever the tolerances are, an optimization can't be allowed to leak water
+		bool KeepsWater = !Scenario.Rain && Scenario.Boundary != BoundaryPolicy::Open;
+		bool KeepsSolids = KeepsWater && Scenario.Transport == SedimentTransport::Flux;
+		if (KeepsWater)
+			Fine &= CheckTotal("water", Run.Start.Water.Sum, Run.End.Water.Sum);
+		if (KeepsSolids)
+			Fine &= CheckTotal("terrain + sediment", Run.Start.Terrain.Sum + Run.Start.Sediment.Sum, Run.End.Terrain.Sum + Run.End.Sediment.Sum);
+
+		Fine &= CheckFields(Scenario, Run, GetPath(Directory, Scenario), "", "golden", Exact);
+		if (HasBaseline(Scenario))
+			Fine &= CheckFields(Scenario, Run, GetPath((std::string(Directory) + "/baseline").c_str(), Scenario), "baseline ", "golden-baseline", Exact);
+
+		std::cout << "  " << (Fine ? "ok" : "FAIL") << std::endl;
+		Failed += !Fine;
+	}
+	return Failed + CheckTransport() + CheckLODSteepness() + CheckAllocations();
+}
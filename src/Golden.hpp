@@ -0,0 +1,27 @@
+#ifndef GOLDEN_HPP
+#define GOLDEN_HPP
+
+// Fixed 1D and 2D scenarios, run for a fixed number of steps from fixed terrain (no rand, the rain of the World only depends on the step)
+// Record saves the fields they end with to <Directory>/<scenario>.golden, Check runs them again and compares,
+// so a faster Pipe::Update or UpdateSteepness can be checked against what the solver did before it
+// The files are text with 9 digits per float, thats exact, so they read back the same bits anywhere
+//
+// The closed scenarios without rain that use Flux also get compared to <Directory>/baseline/, written by make golden-baseline
+// from the solver before any of the optimizations, what moved the fields off it on purpose:
+// - ghost cells: the baseline never updated its border, Closed copies the inside into it before each step now, the baseline
+//   references are recorded with that copy, without it the terrain next to the border is off by up to 1.2
+// - CellUpdate scratch instead of the Temp* members, the unstable slope set, the clamp of deposition: same arithmetic,
+//   the set only skips cells whose changes are all 0, bit for bit the same as the baseline (2d-closed-steep slumps)
+// - rain: the baseline rains with std::rand, RainSource only depends on the step and the row and a step's rain falls at
+//   the end of the step before it, so the scenarios with rain only have references of the current solver
+// - SemiLagrangian and MacCormack are new, the baseline only has Flux, CheckGolden checks how far they carry sediment instead
+
+// Returns the number of scenarios that couldn't be saved
+int RecordGolden(const char* Directory);
+
+// Returns the number of scenarios that differ by more than the tolerances (or all the bits, with Exact), broke an invariant or blew up
+// Also checks that every transport carries sediment as far as a uniform flow does, and that no solver allocates in a step
+// once its warmed up (needs Allocations.cpp linked in), those need no files
+int CheckGolden(const char* Directory, bool Exact);
+
+#endif
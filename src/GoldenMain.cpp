@@ -0,0 +1,28 @@
+#include <iostream>
+#include <string>
+
+#include "Golden.hpp"
+
+// make test, the golden runs of ./WaterTest golden without the window, so it runs where there is no MLX42 or GLFW
+// ./WaterGolden record <dir> before changing the solver, ./WaterGolden check <dir> [--exact] after (see Golden.hpp)
+int main(int argc, char** argv)
+{
+	bool Exact = false;
+	for (int i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--exact")
+		{
+			Exact = true;
+			for (int j = i; j < argc - 1; j++)
+				argv[j] = argv[j + 1];
+			argc--;
+			break;
+		}
+
+	if (argc > 2 && std::string(argv[1]) == "record")
+		return RecordGolden(argv[2]) != 0;
+	if (argc > 2 && std::string(argv[1]) == "check")
+		return CheckGolden(argv[2], Exact) != 0;
+
+	std::cerr << "Usage: " << argv[0] << " record|check <dir> [--exact]" << std::endl;
+	return 1;
+}
@@ -0,0 +1,368 @@
+#include "LODGrid2D.hpp"
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+// Only the interior is simulated, same as Cell2D::UpdateCells, the outer ring acts as a closed wall
+LODGrid2D::LODGrid2D(Cell2D* Cells, int SizeX, int SizeY, int BlockSize, int NumThreads) : Cells(Cells), SizeX(SizeX), SizeY(SizeY), BlockSize(BlockSize), StepsSinceRebuild(INT_MAX), Pool(NumThreads)
+{
+	BlocksX = (SizeX - 2 + BlockSize - 1) / BlockSize;
+	BlocksY = (SizeY - 2 + BlockSize - 1) / BlockSize;
+	BlockLevels.resize(BlocksX * BlocksY, 0);
+	BlockNodeStart.resize(BlocksX * BlocksY, 0);
+
+	// As many as when every block is fine, so a Rebuild never has to grow them
+	Nodes.reserve(GetFineCellCount());
+	Faces.reserve(GetFineCellCount() * 2);
+	NodeFaces.reserve(GetFineCellCount() * 4);
+}
+
+LODGrid2D::~LODGrid2D() { }
+
+int LODGrid2D::GetNodeCount() const { return Nodes.size(); }
+int LODGrid2D::GetFineCellCount() const { return (SizeX - 2) * (SizeY - 2); }
+
+// Blocks at the right and bottom edge can be smaller, the nodes have to fit exactly
+int LODGrid2D::GetMaxLevel(const SimulationVariables& Variables, int BlockX, int BlockY) const
+{
+	int Width = std::min(BlockSize, SizeX - 2 - BlockX * BlockSize);
+	int Height = std::min(BlockSize, SizeY - 2 - BlockY * BlockSize);
+
+	int Level = 0;
+	while (Level < Variables.LOD_MAX_LEVEL)
+	{
+		int Size = 2 << Level;
+		if (Size > BlockSize || Width % Size != 0 || Height % Size != 0)
+			break;
+		Level++;
+	}
+	return Level;
+}
+
+// Anything above the thresholds is level 0, every halving below them is one level coarser
+int LODGrid2D::GetBlockLevel(const SimulationVariables& Variables, int BlockX, int BlockY) const
+{
+	int StartX = 1 + BlockX * BlockSize;
+	int StartY = 1 + BlockY * BlockSize;
+	int EndX = std::min(StartX + BlockSize, SizeX - 1);
+	int EndY = std::min(StartY + BlockSize, SizeY - 1);
+
+	float Metric = 0;
+	for (int y = StartY; y < EndY; y++)
+		for (int x = StartX; x < EndX; x++)
+		{
+			int i = x + y * SizeX;
+			Cell2D& Curr = Cells[i];
+
+			float Flux = Curr.Left.FlowVolume + Curr.Right.FlowVolume + Curr.Up.FlowVolume + Curr.Down.FlowVolume;
+			float Laplacian = Cells[i - 1].TerrainHeight + Cells[i + 1].TerrainHeight + Cells[i - SizeX].TerrainHeight + Cells[i + SizeX].TerrainHeight - 4 * Curr.TerrainHeight;
+			float Curvature = std::abs(Laplacian) / (Variables.PIPE_LENGTH * Variables.PIPE_LENGTH);
+
+			Metric = std::max(Metric, Curr.GetLiquidHeight() / Variables.LOD_DEPTH);
+			Metric = std::max(Metric, Flux / Variables.LOD_FLUX);
+			Metric = std::max(Metric, Curvature / Variables.LOD_CURVATURE);
+		}
+
+	if (Metric >= 1)
+		return 0;
+	if (Metric <= 0)
+		return Variables.LOD_MAX_LEVEL;
+	return std::min((int)std::floor(-std::log2(Metric)), Variables.LOD_MAX_LEVEL);
+}
+
+int LODGrid2D::GetNodeAt(int x, int y) const
+{
+	int BlockX = (x - 1) / BlockSize;
+	int BlockY = (y - 1) / BlockSize;
+	int Block = BlockX + BlockY * BlocksX;
+
+	int Size = 1 << BlockLevels[Block];
+	int Width = std::min(BlockSize, SizeX - 2 - BlockX * BlockSize) / Size;
+	int LocalX = (x - 1 - BlockX * BlockSize) / Size;
+	int LocalY = (y - 1 - BlockY * BlockSize) / Size;
+
+	return BlockNodeStart[Block] + LocalX + LocalY * Width;
+}
+
+// Walks the fine cells just past the positive side of a node, every run of cells in the same node becomes one face
+void LODGrid2D::AddFaces(int Node, int Axis, int StartX, int StartY)
+{
+	if (StartX >= SizeX - 1 || StartY >= SizeY - 1)
+		return;
+
+	int Size = Nodes[Node].Size;
+	int Last = -1;
+
+	for (int j = 0; j < Size; j++)
+	{
+		int x = StartX + (Axis == 1 ? j : 0);
+		int y = StartY + (Axis == 0 ? j : 0);
+		int Other = GetNodeAt(x, y);
+
+		if (Other == Last)
+		{
+			Faces.back().Width += 1;
+			continue;
+		}
+		Last = Other;
+
+		LODFace Face;
+		Face.A = Node;
+		Face.B = Other;
+		Face.Axis = Axis;
+		Face.Width = 1;
+		Face.Distance = (Size + Nodes[Other].Size) / 2.0f;
+
+		// Fine to fine keeps its flux, anything else starts still, coarse blocks are calm anyway
+		if (Size == 1 && Nodes[Other].Size == 1)
+		{
+			int i = x + y * SizeX;
+			Face.AB = Axis == 0 ? Cells[i - 1].Right : Cells[i - SizeX].Down;
+			Face.BA = Axis == 0 ? Cells[i].Left : Cells[i].Up;
+		}
+		Faces.push_back(Face);
+	}
+}
+
+void LODGrid2D::Rebuild(const SimulationVariables& Variables)
+{
+	for (int by = 0; by < BlocksY; by++)
+		for (int bx = 0; bx < BlocksX; bx++)
+			BlockLevels[bx + by * BlocksX] = std::min(GetBlockLevel(Variables, bx, by), GetMaxLevel(Variables, bx, by));
+
+	// At most one level between neighbouring blocks, so water running into a coarse block doesn't hit a wall of huge nodes
+	// The partial blocks at the edge are already clamped above, clamping after this could drop one more than a level below its neighbour
+	for (int Pass = 0; Pass < Variables.LOD_MAX_LEVEL; Pass++)
+		for (int by = 0; by < BlocksY; by++)
+			for (int bx = 0; bx < BlocksX; bx++)
+			{
+				int& Level = BlockLevels[bx + by * BlocksX];
+				if (bx > 0) Level = std::min(Level, BlockLevels[bx - 1 + by * BlocksX] + 1);
+				if (bx < BlocksX - 1) Level = std::min(Level, BlockLevels[bx + 1 + by * BlocksX] + 1);
+				if (by > 0) Level = std::min(Level, BlockLevels[bx + (by - 1) * BlocksX] + 1);
+				if (by < BlocksY - 1) Level = std::min(Level, BlockLevels[bx + (by + 1) * BlocksX] + 1);
+			}
+
+	// Nodes, averaged from the fine cells
+	Nodes.clear();
+	for (int by = 0; by < BlocksY; by++)
+		for (int bx = 0; bx < BlocksX; bx++)
+		{
+			int Block = bx + by * BlocksX;
+			int Size = 1 << BlockLevels[Block];
+			int StartX = 1 + bx * BlockSize;
+			int StartY = 1 + by * BlockSize;
+			int EndX = std::min(StartX + BlockSize, SizeX - 1);
+			int EndY = std::min(StartY + BlockSize, SizeY - 1);
+
+			BlockNodeStart[Block] = Nodes.size();
+			for (int ny = StartY; ny < EndY; ny += Size)
+				for (int nx = StartX; nx < EndX; nx += Size)
+				{
+					CellLOD Node;
+					Node.Size = Size;
+
+					for (int y = ny; y < ny + Size; y++)
+						for (int x = nx; x < nx + Size; x++)
+						{
+							Cell2D& Curr = Cells[x + y * SizeX];
+							Node.TerrainHeight += Curr.TerrainHeight;
+							Node.WaterHeight += Curr.WaterHeight;
+							Node.Sediment += Curr.Sediment;
+							Node.Velocity.first += Curr.Velocity.first;
+							Node.Velocity.second += Curr.Velocity.second;
+						}
+
+					float Area = Node.GetArea();
+					Node.TerrainHeight /= Area;
+					Node.WaterHeight /= Area;
+					Node.Sediment /= Area;
+					Node.Velocity.first /= Area;
+					Node.Velocity.second /= Area;
+					Node.BaseTerrainHeight = Node.TerrainHeight;
+
+					Nodes.push_back(Node);
+				}
+		}
+
+	// Faces, every node adds the ones on its right and bottom side
+	Faces.clear();
+	for (int by = 0; by < BlocksY; by++)
+		for (int bx = 0; bx < BlocksX; bx++)
+		{
+			int Block = bx + by * BlocksX;
+			int Size = 1 << BlockLevels[Block];
+			int StartX = 1 + bx * BlockSize;
+			int StartY = 1 + by * BlockSize;
+			int EndX = std::min(StartX + BlockSize, SizeX - 1);
+			int EndY = std::min(StartY + BlockSize, SizeY - 1);
+
+			int Node = BlockNodeStart[Block];
+			for (int ny = StartY; ny < EndY; ny += Size)
+				for (int nx = StartX; nx < EndX; nx += Size, Node++)
+				{
+					AddFaces(Node, 0, nx + Size, ny);
+					AddFaces(Node, 1, nx, ny + Size);
+				}
+		}
+
+	// And the list of faces per node
+	for (size_t i = 0; i < Nodes.size(); i++)
+		Nodes[i].FaceCount = 0;
+	for (size_t i = 0; i < Faces.size(); i++)
+	{
+		Nodes[Faces[i].A].FaceCount++;
+		Nodes[Faces[i].B].FaceCount++;
+	}
+
+	int Start = 0;
+	for (size_t i = 0; i < Nodes.size(); i++)
+	{
+		Nodes[i].FaceStart = Start;
+		Start += Nodes[i].FaceCount;
+		Nodes[i].FaceCount = 0;
+	}
+
+	// Left, right, up and down, the order Cell2D::UpdateSteepness sums them in
+	NodeFaces.resize(Start);
+	for (int Side = 0; Side < 4; Side++)
+		for (size_t i = 0; i < Faces.size(); i++)
+		{
+			if (Faces[i].Axis != Side / 2)
+				continue;
+			CellLOD& Node = Nodes[Side % 2 == 0 ? Faces[i].B : Faces[i].A];
+			NodeFaces[Node.FaceStart + Node.FaceCount++] = i;
+		}
+
+	// Corners, the fine cell just past each one, past the edge its the one next to it, like the ghosts of a closed Cell2D
+	// Only kept if the other node has this one past as many of its corners, so whatever slumps into one node leaves the other
+	for (int by = 0; by < BlocksY; by++)
+		for (int bx = 0; bx < BlocksX; bx++)
+		{
+			int Block = bx + by * BlocksX;
+			int Size = 1 << BlockLevels[Block];
+			int StartX = 1 + bx * BlockSize;
+			int StartY = 1 + by * BlockSize;
+			int EndX = std::min(StartX + BlockSize, SizeX - 1);
+			int EndY = std::min(StartY + BlockSize, SizeY - 1);
+
+			int Node = BlockNodeStart[Block];
+			for (int ny = StartY; ny < EndY; ny += Size)
+				for (int nx = StartX; nx < EndX; nx += Size, Node++)
+					for (int Corner = 0; Corner < 4; Corner++)
+					{
+						int x = std::min(std::max(Corner % 2 == 0 ? nx - 1 : nx + Size, 1), SizeX - 2);
+						int y = std::min(std::max(Corner / 2 == 0 ? ny - 1 : ny + Size, 1), SizeY - 2);
+						int Other = GetNodeAt(x, y);
+						Nodes[Node].Corners[Corner] = Other == Node ? -1 : Other;
+					}
+		}
+
+	// Between fine nodes it always has, a coarse node next to a bigger one can be past its corner without the other way around
+	// The ones to drop are first marked as -2 - Other, so the ones after still count them
+	auto GetOriginal = [](int Corner) { return Corner <= -2 ? -2 - Corner : Corner; };
+	for (size_t i = 0; i < Nodes.size(); i++)
+		for (int Corner = 0; Corner < 4; Corner++)
+		{
+			int Other = Nodes[i].Corners[Corner];
+			if (Other < 0)
+				continue;
+			int Count = 0;
+			int OtherCount = 0;
+			for (int j = 0; j < 4; j++)
+			{
+				Count += GetOriginal(Nodes[i].Corners[j]) == Other;
+				OtherCount += GetOriginal(Nodes[Other].Corners[j]) == (int)i;
+			}
+			if (Count != OtherCount)
+				Nodes[i].Corners[Corner] = -2 - Other;
+		}
+	for (size_t i = 0; i < Nodes.size(); i++)
+		for (int Corner = 0; Corner < 4; Corner++)
+			Nodes[i].Corners[Corner] = std::max(Nodes[i].Corners[Corner], -1);
+
+	StepsSinceRebuild = 0;
+}
+
+// Coarse nodes give every fine cell the same water and sediment height, and the same change in terrain height, so nothing is lost
+// A fine node is the cell, it gives the height back as it is, adding the change would round it
+void LODGrid2D::WriteBack()
+{
+	for (int by = 0; by < BlocksY && !Nodes.empty(); by++)
+		for (int bx = 0; bx < BlocksX; bx++)
+		{
+			int Block = bx + by * BlocksX;
+			int Size = 1 << BlockLevels[Block];
+			int StartX = 1 + bx * BlockSize;
+			int StartY = 1 + by * BlockSize;
+			int EndX = std::min(StartX + BlockSize, SizeX - 1);
+			int EndY = std::min(StartY + BlockSize, SizeY - 1);
+
+			int NodeIndex = BlockNodeStart[Block];
+			for (int ny = StartY; ny < EndY; ny += Size)
+				for (int nx = StartX; nx < EndX; nx += Size, NodeIndex++)
+				{
+					CellLOD& Node = Nodes[NodeIndex];
+					float TerrainChange = Node.TerrainHeight - Node.BaseTerrainHeight;
+
+					for (int y = ny; y < ny + Size; y++)
+						for (int x = nx; x < nx + Size; x++)
+						{
+							Cell2D& Curr = Cells[x + y * SizeX];
+							Curr.TerrainHeight = Size == 1 ? Node.TerrainHeight : Curr.TerrainHeight + TerrainChange;
+							Curr.WaterHeight = Node.WaterHeight;
+							Curr.Sediment = Node.Sediment;
+							Curr.Velocity = Node.Velocity;
+							Curr.Left.FlowVolume = 0;
+							Curr.Right.FlowVolume = 0;
+							Curr.Up.FlowVolume = 0;
+							Curr.Down.FlowVolume = 0;
+						}
+					Node.BaseTerrainHeight = Node.TerrainHeight;
+
+					if (Size != 1)
+						continue;
+
+					Cell2D& Curr = Cells[nx + ny * SizeX];
+					for (int i = Node.FaceStart; i < Node.FaceStart + Node.FaceCount; i++)
+					{
+						LODFace& Face = Faces[NodeFaces[i]];
+						bool IsA = Face.A == NodeIndex;
+						if (Face.Axis == 0)
+							(IsA ? Curr.Right : Curr.Left) = IsA ? Face.AB : Face.BA;
+						else
+							(IsA ? Curr.Down : Curr.Up) = IsA ? Face.AB : Face.BA;
+					}
+				}
+		}
+}
+
+void LODGrid2D::UpdateCells(const SimulationVariables& Variables)
+{
+	if (StepsSinceRebuild >= Variables.LOD_REGRID_INTERVAL)
+	{
+		WriteBack();
+		Rebuild(Variables);
+	}
+	StepsSinceRebuild++;
+
+	CellLOD* Ptr = Nodes.data();
+	LODFace* FacePtr = Faces.data();
+	const int* NodeFacePtr = NodeFaces.data();
+	int Count = Nodes.size();
+	const int ChunkSize = 256;
+
+	// Every node gets the average rainfall instead of the drops of the World, a drop on one fine cell would be spread over the whole node anyway
+	// That also means no rain map and no springs here, see LODGrid2D.hpp
+	Pool.ParallelFor(0, Count, ChunkSize, [&](int i) { Ptr[i].WaterHeight += Variables.RAINFALL * Variables.DT; });
+	Pool.ParallelFor(0, Count, ChunkSize, [&](int i) { Ptr[i].UpdatePipes(Variables, Ptr, FacePtr, NodeFacePtr); });
+	Pool.ParallelFor(0, Count, ChunkSize, [&](int i) {
+		Ptr[i].UpdateWaterSurfaceAndSediment(Variables, Ptr, FacePtr, NodeFacePtr);
+		Ptr[i].UpdateSteepness(Variables, Ptr, FacePtr, NodeFacePtr);
+	});
+	Pool.ParallelFor(0, Count, ChunkSize, [&](int i) {
+		Ptr[i].FinishWaterSurfaceAndSediment(Ptr[i].Pending);
+		Ptr[i].UpdateErosionAndDeposition(Variables);
+		Ptr[i].UpdateEvaporation(Variables);
+	});
+}
@@ -0,0 +1,58 @@
+#ifndef LODGRID2D_HPP
+#define LODGRID2D_HPP
+
+#include <vector>
+#include "SimulationVariables.hpp"
+#include "Cell2D.hpp"
+#include "CellLOD.hpp"
+#include "ThreadPool.hpp"
+
+// Adaptive version of Cell2D::UpdateCells
+// The interior of the grid is split in blocks of BlockSize x BlockSize cells, every block picks a level,
+// and is simulated as nodes of 2^level x 2^level cells, dry and flat blocks end up coarse, wet and steep blocks stay fine
+// Nodes are connected by faces holding the pipes, so the flux between levels is conservative, whatever leaves one node enters the other
+// The fine cells stay the real state, they are only written to on WriteBack, and read from on Rebuild
+// The ghost ring is always a closed wall here, Variables.Boundary is only used by Cell2D::UpdateCells
+// With every block at level 0 the terrain slumps the same as in the World, to the bit (the golden check has a dry grid for that)
+// What it doesn't do:
+// - It saves steps, not memory, the fine grid stays the full SizeX x SizeY Cell2D array, the nodes and faces come on top of that
+// - Every node gets Variables.RAINFALL, the rain map and springs of the World (World2D::SetRainMap, AddSpring) are ignored while its on
+class LODGrid2D {
+	public:
+		LODGrid2D(Cell2D* Cells, int SizeX, int SizeY, int BlockSize = 16, int NumThreads = 0);
+		LODGrid2D(const LODGrid2D& From) = delete;
+
+		~LODGrid2D();
+
+		LODGrid2D& operator = (const LODGrid2D& From) = delete;
+
+		void Rebuild(const SimulationVariables& Variables);
+		void WriteBack();
+		void UpdateCells(const SimulationVariables& Variables);
+
+		int GetNodeCount() const;
+		int GetFineCellCount() const;
+
+	private:
+		Cell2D* Cells;
+		int SizeX;
+		int SizeY;
+		int BlockSize;
+		int BlocksX;
+		int BlocksY;
+		int StepsSinceRebuild;
+		ThreadPool Pool;
+
+		std::vector<int> BlockLevels;
+		std::vector<int> BlockNodeStart;
+		std::vector<CellLOD> Nodes;
+		std::vector<LODFace> Faces;
+		std::vector<int> NodeFaces;
+
+		int GetBlockLevel(const SimulationVariables& Variables, int BlockX, int BlockY) const;
+		int GetMaxLevel(const SimulationVariables& Variables, int BlockX, int BlockY) const;
+		int GetNodeAt(int x, int y) const;
+		void AddFaces(int Node, int Axis, int StartX, int StartY);
+};
+
+#endif
@@ -0,0 +1,354 @@
+#include "LakeSolver.hpp"
+#include <algorithm>
+
+static const double NoLevel = -1e30;
+
+LakeSolver::LakeSolver() : SizeX(0), SizeY(0), Wrap(false), Open(false), NodeCount(0) { }
+
+LakeSolver::~LakeSolver() { }
+
+int LakeSolver::Find(int i)
+{
+	while (Sets[i] != i)
+	{
+		Sets[i] = Sets[Sets[i]];
+		i = Sets[i];
+	}
+	return i;
+}
+
+// The 4 cells next to an interior cell, the ghosts are the other side with Wrap, the ocean when Open, and nothing when Closed
+int LakeSolver::GetNeighbours(int i, int* Out) const
+{
+	int x = i % SizeX;
+	int y = i / SizeX;
+	int Offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	int Count = 0;
+
+	for (int k = 0; k < 4; k++)
+	{
+		int nx = x + Offsets[k][0];
+		int ny = y + Offsets[k][1];
+		if (nx < 1 || nx > SizeX - 2 || ny < 1 || ny > SizeY - 2)
+		{
+			if (Open)
+				Out[Count++] = SizeX * SizeY;
+			else if (Wrap)
+			{
+				nx = nx < 1 ? SizeX - 2 : (nx > SizeX - 2 ? 1 : nx);
+				ny = ny < 1 ? SizeY - 2 : (ny > SizeY - 2 ? 1 : ny);
+				Out[Count++] = nx + ny * SizeX;
+			}
+			continue;
+		}
+		Out[Count++] = nx + ny * SizeX;
+	}
+	return Count;
+}
+
+// The ocean never fills
+bool LakeSolver::IsFull(int Id) const
+{
+	return Id > Ocean && Nodes[Id].Final >= Nodes[Id].OwnCapacity;
+}
+
+// The second sweep finds the level of a lake as soon as the basin can hold its water below the next cell
+void LakeSolver::TrySolve(int Root, float Height)
+{
+	Node& Curr = Nodes[TopNode[Root]];
+	if (!Curr.Lake || Curr.Solved || Area[Root] <= 0)
+		return;
+
+	if (Area[Root] * Height - SumBed[Root] >= Curr.Final)
+	{
+		Curr.Level = (Curr.Final + SumBed[Root]) / Area[Root];
+		Curr.Solved = true;
+	}
+}
+
+int LakeSolver::Merge(int A, int B, float Height, bool Build)
+{
+	int OceanSet = SizeX * SizeY;
+
+	if (!Build)
+	{
+		TrySolve(A, Height);
+		TrySolve(B, Height);
+	}
+
+	// Spilling over the edge, the ocean takes the whole basin
+	if (A == OceanSet || B == OceanSet)
+	{
+		int Other = A == OceanSet ? B : A;
+		if (Build)
+		{
+			Node& Spilled = Nodes[TopNode[Other]];
+			Spilled.Parent = Ocean;
+			Spilled.Capacity = Area[Other] * Height - SumBed[Other];
+		}
+		Sets[Other] = OceanSet;
+		return OceanSet;
+	}
+
+	int Id = NodeCount++;
+	if (Build)
+	{
+		Node Saddle;
+		Saddle.Children[0] = TopNode[A];
+		Saddle.Children[1] = TopNode[B];
+		Saddle.Parent = -1;
+		Saddle.Height = Height;
+		Saddle.MinHeight = std::min(Nodes[TopNode[A]].MinHeight, Nodes[TopNode[B]].MinHeight);
+		Saddle.Capacity = 0;
+		Saddle.Volume = 0;
+		Saddle.Final = 0;
+		Saddle.Level = NoLevel;
+		Saddle.Lake = false;
+		Saddle.Solved = false;
+
+		Nodes[TopNode[A]].Parent = Id;
+		Nodes[TopNode[A]].Capacity = Area[A] * Height - SumBed[A];
+		Nodes[TopNode[B]].Parent = Id;
+		Nodes[TopNode[B]].Capacity = Area[B] * Height - SumBed[B];
+		Saddle.OwnCapacity = Nodes[TopNode[A]].Capacity + Nodes[TopNode[B]].Capacity;
+		Nodes.push_back(Saddle);
+	}
+
+	// Union by size, the new root keeps the sums
+	if (Area[A] < Area[B])
+		std::swap(A, B);
+	Sets[B] = A;
+	Area[A] += Area[B];
+	SumBed[A] += SumBed[B];
+	TopNode[A] = Id;
+	return A;
+}
+
+// Visits the cells from low to high, Build makes the tree, the second time around it only finds the lake levels
+// Both times the nodes are made in the same order, so the second sweep can use the ids of the first
+void LakeSolver::Sweep(bool Build)
+{
+	int OceanSet = SizeX * SizeY;
+	std::fill(Sets.begin(), Sets.end(), -1);
+	Sets[OceanSet] = OceanSet;
+	TopNode[OceanSet] = Ocean;
+	NodeCount = 1;
+
+	for (int Cell : Order)
+	{
+		float Height = Bed[Cell];
+
+		int Neighbours[4];
+		int Count = GetNeighbours(Cell, Neighbours);
+		int Roots[4];
+		int RootCount = 0;
+		for (int k = 0; k < Count; k++)
+		{
+			if (Sets[Neighbours[k]] < 0)
+				continue;
+			int Root = Find(Neighbours[k]);
+			if (std::find(Roots, Roots + RootCount, Root) == Roots + RootCount)
+				Roots[RootCount++] = Root;
+		}
+
+		int Root = Cell;
+		if (RootCount == 0)
+		{
+			// A pit
+			int Id = NodeCount++;
+			if (Build)
+			{
+				Node Pit;
+				Pit.Children[0] = -1;
+				Pit.Children[1] = -1;
+				Pit.Parent = -1;
+				Pit.Height = Height;
+				Pit.MinHeight = Height;
+				Pit.Capacity = 0;
+				Pit.OwnCapacity = 0;
+				Pit.Volume = 0;
+				Pit.Final = 0;
+				Pit.Level = NoLevel;
+				Pit.Lake = false;
+				Pit.Solved = false;
+				Nodes.push_back(Pit);
+			}
+			Sets[Cell] = Cell;
+			Area[Cell] = 0;
+			SumBed[Cell] = 0;
+			TopNode[Cell] = Id;
+		}
+		else
+		{
+			Root = Roots[0];
+			if (!Build)
+				TrySolve(Root, Height);
+			for (int k = 1; k < RootCount; k++)
+				Root = Merge(Root, Roots[k], Height, Build);
+			Sets[Cell] = Root;
+		}
+
+		if (Root != OceanSet)
+		{
+			Area[Root] += 1;
+			SumBed[Root] += Height;
+		}
+		NodeOf[Cell] = TopNode[Root];
+	}
+}
+
+double LakeSolver::Solve(const SimulationVariables& Variables, Cell2D* Cells, int NewSizeX, int NewSizeY)
+{
+	SizeX = NewSizeX;
+	SizeY = NewSizeY;
+	Wrap = Variables.Boundary == BoundaryPolicy::Periodic;
+	Open = Variables.Boundary == BoundaryPolicy::Open;
+	int Size = SizeX * SizeY;
+
+	Bed.resize(Size);
+	Rank.resize(Size);
+	Sets.resize(Size + 1);
+	Area.resize(Size + 1);
+	SumBed.resize(Size + 1);
+	TopNode.resize(Size + 1);
+	NodeOf.resize(Size);
+	Flow.resize(Size);
+	Order.clear();
+	for (int y = 1; y < SizeY - 1; y++)
+		for (int x = 1; x < SizeX - 1; x++)
+		{
+			int i = x + y * SizeX;
+			Bed[i] = Cells[i].TerrainHeight + Cells[i].Sediment;
+			Order.push_back(i);
+		}
+	if (Order.empty())
+		return 0;
+
+	// Ties by index, so every cell has a strictly lower neighbour unless its a pit
+	std::sort(Order.begin(), Order.end(), [&](int A, int B) { return Bed[A] < Bed[B] || (Bed[A] == Bed[B] && A < B); });
+	for (size_t k = 0; k < Order.size(); k++)
+		Rank[Order[k]] = k;
+
+	Nodes.clear();
+	Node OceanNode = Node();
+	OceanNode.Parent = -1;
+	OceanNode.Level = NoLevel;
+	Nodes.push_back(OceanNode);
+	Sweep(true);
+
+	// Every cell hands its water to its lowest neighbour, from high to low, until it reaches a pit or the edge
+	double Drained = 0;
+	for (int Cell : Order)
+		Flow[Cell] = Cells[Cell].WaterHeight;
+	for (int k = Order.size() - 1; k >= 0; k--)
+	{
+		int Cell = Order[k];
+		int Neighbours[4];
+		int Count = GetNeighbours(Cell, Neighbours);
+		int Lowest = -1;
+		for (int n = 0; n < Count; n++)
+		{
+			if (Neighbours[n] == Size)
+			{
+				Lowest = Size;
+				break;
+			}
+			if (Rank[Neighbours[n]] < k && (Lowest < 0 || Rank[Neighbours[n]] < Rank[Lowest]))
+				Lowest = Neighbours[n];
+		}
+
+		if (Lowest == Size)
+			Drained += Flow[Cell];
+		else if (Lowest >= 0)
+			Flow[Lowest] += Flow[Cell];
+		else
+			Nodes[NodeOf[Cell]].Volume += Flow[Cell];
+	}
+
+	// Children are always made before their parents
+	for (int n = 1; n < NodeCount; n++)
+		if (Nodes[n].Children[0] >= 0)
+			Nodes[n].Volume = Nodes[Nodes[n].Children[0]].Volume + Nodes[Nodes[n].Children[1]].Volume;
+
+	// From the top, how much water every node ends up with
+	// A node under the water of its parent is not a lake of its own, its level is the one of the parent
+	for (int n = NodeCount - 1; n >= 1; n--)
+	{
+		Node& Curr = Nodes[n];
+		if (Curr.Parent < 0)
+			Curr.Final = Curr.Volume;
+		else if (Curr.Parent == Ocean)
+		{
+			Curr.Final = std::min(Curr.Volume, Curr.Capacity);
+			Drained += Curr.Volume - Curr.Final;
+		}
+
+		bool Full = Curr.Final >= Curr.OwnCapacity;
+		Curr.Lake = Full && Curr.Final > 0 && !IsFull(Curr.Parent);
+
+		if (Curr.Children[0] < 0)
+			continue;
+
+		Node& A = Nodes[Curr.Children[0]];
+		Node& B = Nodes[Curr.Children[1]];
+		if (Full)
+		{
+			// Both full, the rest stands above the saddle
+			A.Final = A.Capacity;
+			B.Final = B.Capacity;
+			continue;
+		}
+
+		// Water that spilled in from a sibling higher up goes to the deepest child, that one spills to the other if its full
+		double InA = A.Volume;
+		double InB = B.Volume;
+		if (A.MinHeight <= B.MinHeight)
+			InA += Curr.Final - (A.Volume + B.Volume);
+		else
+			InB += Curr.Final - (A.Volume + B.Volume);
+
+		if (InA > A.Capacity)
+		{
+			InB += InA - A.Capacity;
+			InA = A.Capacity;
+		}
+		else if (InB > B.Capacity)
+		{
+			InA += InB - B.Capacity;
+			InB = B.Capacity;
+		}
+		A.Final = std::max(InA, 0.0);
+		B.Final = std::max(InB, 0.0);
+	}
+
+	Sweep(false);
+
+	// The lakes that never hit a saddle stand above every cell of their basin
+	for (int Cell : Order)
+	{
+		int Root = Find(Cell);
+		if (Root != Size)
+			TrySolve(Root, 1e30f);
+	}
+
+	// Full nodes are under the water of their parent, the parents come first from the top
+	for (int n = NodeCount - 1; n >= 1; n--)
+	{
+		Node& Curr = Nodes[n];
+		if (!Curr.Lake)
+			Curr.Level = IsFull(Curr.Parent) ? Nodes[Curr.Parent].Level : NoLevel;
+	}
+
+	for (int Cell : Order)
+	{
+		Cell2D& Curr = Cells[Cell];
+		Curr.WaterHeight = std::max(0.0, Nodes[NodeOf[Cell]].Level - Bed[Cell]);
+		Curr.Velocity = std::make_pair(0.0f, 0.0f);
+		Curr.Left.FlowVolume = 0;
+		Curr.Right.FlowVolume = 0;
+		Curr.Up.FlowVolume = 0;
+		Curr.Down.FlowVolume = 0;
+	}
+
+	return Drained * Variables.PIPE_LENGTH * Variables.PIPE_LENGTH;
+}
@@ -0,0 +1,72 @@
+#ifndef LAKESOLVER_HPP
+#define LAKESOLVER_HPP
+
+#include <vector>
+#include "SimulationVariables.hpp"
+#include "Cell2D.hpp"
+
+// Puts the water of a grid where the pipes would end up putting it after a long time, in one go (fill, spill, merge)
+// The bed is TerrainHeight + Sediment, the sediment stays where it is, only the water moves
+//	1. Every cell is visited from low to high, cells that touch join into basins, where two basins meet is a saddle
+//	   so the basins make a tree, the leaves are the pits, a node is two basins that merged at the height of the saddle
+//	2. The water of every cell runs downhill to a pit, and goes up the tree, a basin that holds more than it can below
+//	   the saddle spills the rest into the other one, if both are full the water stands above the saddle
+//	3. The same visit again, now that its known how much water every basin holds, gives the level of every lake
+// With an Open boundary the edge is a basin that never fills, whatever spills into it is gone
+// The lakes are flat and still afterwards, the pipes and velocities are 0, the explicit solver takes it from there
+class LakeSolver {
+	public:
+		LakeSolver();
+		LakeSolver(const LakeSolver& From) = delete;
+
+		~LakeSolver();
+
+		LakeSolver& operator = (const LakeSolver& From) = delete;
+
+		// Only the interior, the ghosts are filled by the next step anyway, returns the volume that left over the edge
+		double Solve(const SimulationVariables& Variables, Cell2D* Cells, int SizeX, int SizeY);
+
+	private:
+		struct Node
+		{
+			int Children[2];	// -1 for a pit
+			int Parent;			// -1 if it never merged, Ocean if it spilled over the edge
+			float Height;		// of the saddle, or the bottom of a pit
+			float MinHeight;	// lowest cell
+			double Capacity;	// water it holds below the saddle with its parent
+			double OwnCapacity;	// water it holds below its own saddle, what the children hold below Height
+			double Volume;		// water that runs into it
+			double Final;		// water it ends up with
+			double Level;		// of the water in it, -1e30 when its not under water
+			bool Lake;			// its own flat surface, above the saddle of its children
+			bool Solved;
+		};
+
+		static const int Ocean = 0;
+
+		int SizeX;
+		int SizeY;
+		bool Wrap;
+		bool Open;
+		int NodeCount;
+
+		std::vector<Node> Nodes;
+		std::vector<float> Bed;
+		std::vector<int> Order;		// interior cells from low to high
+		std::vector<int> Rank;		// position in Order
+		std::vector<int> Sets;		// union find, -1 when not visited yet, the ocean is index SizeX * SizeY
+		std::vector<double> Area;	// of the basin, per root
+		std::vector<double> SumBed;	// per root
+		std::vector<int> TopNode;	// per root
+		std::vector<int> NodeOf;	// the top node of the basin a cell joined
+		std::vector<double> Flow;
+
+		int Find(int i);
+		bool IsFull(int Id) const;
+		int GetNeighbours(int i, int* Out) const;
+		int Merge(int A, int B, float Height, bool Build);
+		void TrySolve(int Root, float Height);
+		void Sweep(bool Build);
+};
+
+#endif
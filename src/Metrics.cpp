@@ -0,0 +1,115 @@
+#include "Metrics.hpp"
+#include <sstream>
+#include <algorithm>
+
+const char* const Metrics::PhaseNames[Metrics::NumPhases] = { "pipes", "surface", "finish" };
+
+Metrics::Metrics() : NumTiles(0), InteriorCells(0), StartVolume(0), LastSteps(0), LastCells(0), LastPhaseNanoseconds() { }
+
+Metrics::~Metrics() { }
+
+void Metrics::Setup(int NewNumTiles, int NewInteriorCells, double NewStartVolume)
+{
+	std::unique_lock<std::mutex> Lock(RenderMutex);
+
+	NumTiles = NewNumTiles;
+	InteriorCells = NewInteriorCells;
+	StartVolume = NewStartVolume;
+
+	Tiles.reset(new TileCounters[NumTiles]);
+	for (int i = 0; i < NumTiles; i++)
+	{
+		TileCounters& Tile = Tiles[i];
+		for (int Phase = 0; Phase < NumPhases; Phase++)
+		{
+			Tile.PhaseNanoseconds[Phase] = 0;
+			Tile.PhaseRuns[Phase] = 0;
+		}
+		Tile.Steps = 0;
+		Tile.Cells = 0;
+		Tile.ActiveCells = 0;
+		Tile.WaterVolume = 0;
+		Tile.SedimentVolume = 0;
+		Tile.TerrainVolume = 0;
+	}
+
+	LastTime = std::chrono::steady_clock::now();
+	LastSteps = 0;
+	LastCells = 0;
+	std::fill(LastPhaseNanoseconds, LastPhaseNanoseconds + NumPhases, 0);
+}
+
+Metrics::TileCounters& Metrics::GetTile(int Index) { return Tiles[Index]; }
+
+static void WriteMetric(std::ostringstream& Out, const char* Name, const char* Type, const char* Help, double Value)
+{
+	Out << "# HELP " << Name << " " << Help << "\n";
+	Out << "# TYPE " << Name << " " << Type << "\n";
+	Out << Name << " " << Value << "\n";
+}
+
+std::string Metrics::Render()
+{
+	std::unique_lock<std::mutex> Lock(RenderMutex);
+
+	uint64_t Steps = NumTiles > 0 ? UINT64_MAX : 0;	// a step is only done when every tile is done with it
+	uint64_t Cells = 0;
+	uint64_t ActiveCells = 0;
+	double Water = 0;
+	double Sediment = 0;
+	double Terrain = 0;
+	uint64_t PhaseNanoseconds[NumPhases] = {};
+	uint64_t PhaseRuns[NumPhases] = {};
+
+	for (int i = 0; i < NumTiles; i++)
+	{
+		TileCounters& Tile = Tiles[i];
+		Steps = std::min<uint64_t>(Steps, Tile.Steps.load(std::memory_order_relaxed));
+		Cells += Tile.Cells.load(std::memory_order_relaxed);
+		ActiveCells += Tile.ActiveCells.load(std::memory_order_relaxed);
+		Water += Tile.WaterVolume.load(std::memory_order_relaxed);
+		Sediment += Tile.SedimentVolume.load(std::memory_order_relaxed);
+		Terrain += Tile.TerrainVolume.load(std::memory_order_relaxed);
+		for (int Phase = 0; Phase < NumPhases; Phase++)
+		{
+			PhaseNanoseconds[Phase] += Tile.PhaseNanoseconds[Phase].load(std::memory_order_relaxed);
+			PhaseRuns[Phase] += Tile.PhaseRuns[Phase].load(std::memory_order_relaxed);
+		}
+	}
+
+	auto Now = std::chrono::steady_clock::now();
+	double Seconds = std::chrono::duration<double>(Now - LastTime).count();
+	uint64_t NewSteps = Steps - LastSteps;
+
+	std::ostringstream Out;
+	WriteMetric(Out, "watersim_steps_total", "counter", "Steps done by every tile", Steps);
+	WriteMetric(Out, "watersim_steps_per_second", "gauge", "Steps per second since the last scrape", Seconds > 0 ? NewSteps / Seconds : 0);
+	WriteMetric(Out, "watersim_mcells_per_second", "gauge", "Million cell updates per second since the last scrape", Seconds > 0 ? (Cells - LastCells) / Seconds / 1000000 : 0);
+	WriteMetric(Out, "watersim_active_cell_fraction", "gauge", "Part of the interior cells with water", InteriorCells > 0 ? (double)ActiveCells / InteriorCells : 0);
+	WriteMetric(Out, "watersim_water_volume", "gauge", "Total water height of the interior cells", Water);
+	WriteMetric(Out, "watersim_sediment_volume", "gauge", "Total suspended sediment height of the interior cells", Sediment);
+	WriteMetric(Out, "watersim_terrain_volume", "gauge", "Total terrain height of the interior cells", Terrain);
+	WriteMetric(Out, "watersim_conservation_drift", "gauge", "Relative change of terrain + sediment volume since the start", StartVolume != 0 ? (Terrain + Sediment - StartVolume) / StartVolume : 0);
+
+	Out << "# HELP watersim_phase_seconds_total Time spent in every phase, summed over the tiles\n";
+	Out << "# TYPE watersim_phase_seconds_total counter\n";
+	for (int Phase = 0; Phase < NumPhases; Phase++)
+		Out << "watersim_phase_seconds_total{phase=\"" << PhaseNames[Phase] << "\"} " << PhaseNanoseconds[Phase] / 1e9 << "\n";
+
+	Out << "# HELP watersim_phase_runs_total Tiles done with every phase\n";
+	Out << "# TYPE watersim_phase_runs_total counter\n";
+	for (int Phase = 0; Phase < NumPhases; Phase++)
+		Out << "watersim_phase_runs_total{phase=\"" << PhaseNames[Phase] << "\"} " << PhaseRuns[Phase] << "\n";
+
+	Out << "# HELP watersim_phase_seconds_per_step Time per step spent in every phase since the last scrape, summed over the tiles\n";
+	Out << "# TYPE watersim_phase_seconds_per_step gauge\n";
+	for (int Phase = 0; Phase < NumPhases; Phase++)
+		Out << "watersim_phase_seconds_per_step{phase=\"" << PhaseNames[Phase] << "\"} " << (NewSteps > 0 ? (PhaseNanoseconds[Phase] - LastPhaseNanoseconds[Phase]) / 1e9 / NewSteps : 0) << "\n";
+
+	LastTime = Now;
+	LastSteps = Steps;
+	LastCells = Cells;
+	std::copy(PhaseNanoseconds, PhaseNanoseconds + NumPhases, LastPhaseNanoseconds);
+
+	return Out.str();
+}
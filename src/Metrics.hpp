@@ -0,0 +1,57 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+// Counters of a running World2D, every tile has its own, so the solver never writes to anything another thread writes to
+// They are only added together when Render is called, which can happen from any thread while the solver runs
+// The volumes are the last ones every tile saw, with the graph scheduler tiles can be a step or two apart
+class Metrics {
+	public:
+		static const int NumPhases = 3;
+		static const char* const PhaseNames[NumPhases];
+
+		struct alignas(64) TileCounters
+		{
+			std::atomic<uint64_t> PhaseNanoseconds[NumPhases];
+			std::atomic<uint64_t> PhaseRuns[NumPhases];
+			std::atomic<uint64_t> Steps;
+			std::atomic<uint64_t> Cells;
+			std::atomic<uint64_t> ActiveCells;
+			std::atomic<double> WaterVolume;
+			std::atomic<double> SedimentVolume;
+			std::atomic<double> TerrainVolume;
+		};
+
+		Metrics();
+		Metrics(const Metrics& From) = delete;
+
+		~Metrics();
+
+		Metrics& operator = (const Metrics& From) = delete;
+
+		void Setup(int NumTiles, int InteriorCells, double StartVolume);
+		TileCounters& GetTile(int Index);
+
+		std::string Render();	// Prometheus text format
+
+	private:
+		std::unique_ptr<TileCounters[]> Tiles;
+		int NumTiles;
+		int InteriorCells;
+		double StartVolume;	// terrain + sediment when Setup was called
+
+		// What the last Render saw, for the rates
+		std::mutex RenderMutex;
+		std::chrono::steady_clock::time_point LastTime;
+		uint64_t LastSteps;
+		uint64_t LastCells;
+		uint64_t LastPhaseNanoseconds[NumPhases];
+};
+
+#endif
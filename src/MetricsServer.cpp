@@ -0,0 +1,145 @@
+#include "MetricsServer.hpp"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+MetricsServer::MetricsServer(Metrics& Source) : Source(Source), ListenSocket(-1), Running(false) { }
+
+MetricsServer::~MetricsServer() { Stop(); }
+
+bool MetricsServer::Start(const std::string& Address)
+{
+	Stop();
+
+	bool IsPort = !Address.empty() && Address.find_first_not_of("0123456789") == std::string::npos;
+	if (IsPort)
+	{
+		errno = 0;
+		long Port = std::strtol(Address.c_str(), nullptr, 10);
+		if (errno || Port < 1 || Port > 65535)
+		{
+			std::cerr << "metrics: " << Address << " isn't a port, those go from 1 to 65535" << std::endl;
+			return false;
+		}
+
+		ListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+		if (ListenSocket < 0)
+			return false;
+		int Yes = 1;
+		setsockopt(ListenSocket, SOL_SOCKET, SO_REUSEADDR, &Yes, sizeof(Yes));
+
+		sockaddr_in Addr;
+		std::memset(&Addr, 0, sizeof(Addr));
+		Addr.sin_family = AF_INET;
+		Addr.sin_port = htons((uint16_t)Port);
+		Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);	// only localhost, there is no auth
+		if (bind(ListenSocket, (sockaddr*)&Addr, sizeof(Addr)) < 0)
+		{
+			std::cerr << "metrics: can't bind to port " << Address << ": " << std::strerror(errno) << std::endl;
+			close(ListenSocket);
+			ListenSocket = -1;
+			return false;
+		}
+	}
+	else
+	{
+		sockaddr_un Addr;
+		std::memset(&Addr, 0, sizeof(Addr));
+		if (Address.empty() || Address.size() >= sizeof(Addr.sun_path))
+			return false;
+
+		// A socket there is left over from a run that crashed, anything else is a mistyped path and never gets removed
+		struct stat Info;
+		if (lstat(Address.c_str(), &Info) == 0)
+		{
+			if (!S_ISSOCK(Info.st_mode))
+			{
+				std::cerr << "metrics: " << Address << " already exists and isn't a socket" << std::endl;
+				return false;
+			}
+			unlink(Address.c_str());
+		}
+
+		ListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (ListenSocket < 0)
+			return false;
+		Addr.sun_family = AF_UNIX;
+		std::strcpy(Addr.sun_path, Address.c_str());
+		if (bind(ListenSocket, (sockaddr*)&Addr, sizeof(Addr)) < 0)
+		{
+			std::cerr << "metrics: can't bind to " << Address << ": " << std::strerror(errno) << std::endl;
+			close(ListenSocket);
+			ListenSocket = -1;
+			return false;
+		}
+		UnixPath = Address;
+	}
+
+	if (listen(ListenSocket, 8) < 0)
+	{
+		Stop();
+		return false;
+	}
+
+	Running = true;
+	Thread = std::thread(&MetricsServer::Serve, this);
+	return true;
+}
+
+void MetricsServer::Stop()
+{
+	Running = false;
+	if (Thread.joinable())
+		Thread.join();
+	if (ListenSocket >= 0)
+		close(ListenSocket);
+	ListenSocket = -1;
+	if (!UnixPath.empty())
+		unlink(UnixPath.c_str());
+	UnixPath.clear();
+}
+
+void MetricsServer::Serve()
+{
+	while (Running)
+	{
+		// Wake up now and then to see if Stop was called
+		pollfd Poll = { ListenSocket, POLLIN, 0 };
+		if (poll(&Poll, 1, 200) <= 0)
+			continue;
+
+		int Client = accept(ListenSocket, nullptr, nullptr);
+		if (Client < 0)
+			continue;
+
+		// Whatever was asked, the answer is the same, so just read the request so the client doesn't get a reset
+		char Request[1024];
+		pollfd ClientPoll = { Client, POLLIN, 0 };
+		if (poll(&ClientPoll, 1, 200) > 0)
+			recv(Client, Request, sizeof(Request), 0);
+
+		std::string Body = Source.Render();
+		std::string Response = "HTTP/1.0 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: " + std::to_string(Body.size()) + "\r\n"
+			"Connection: close\r\n\r\n" + Body;
+
+		size_t Sent = 0;
+		while (Sent < Response.size())
+		{
+			ssize_t Count = send(Client, Response.data() + Sent, Response.size() - Sent, MSG_NOSIGNAL);
+			if (Count <= 0)
+				break;
+			Sent += Count;
+		}
+		close(Client);
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef METRICSSERVER_HPP
+#define METRICSSERVER_HPP
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include "Metrics.hpp"
+
+// Answers every connection with Metrics::Render as a HTTP response, from its own thread
+// Address is a port on localhost ("9100"), or the path of a unix socket ("/tmp/watersim.sock")
+//	curl localhost:9100/metrics
+//	curl --unix-socket /tmp/watersim.sock localhost/metrics
+class MetricsServer {
+	public:
+		MetricsServer(Metrics& Source);
+		MetricsServer(const MetricsServer& From) = delete;
+
+		~MetricsServer();
+
+		MetricsServer& operator = (const MetricsServer& From) = delete;
+
+		bool Start(const std::string& Address);
+		void Stop();
+
+	private:
+		Metrics& Source;
+		std::string UnixPath;
+		int ListenSocket;
+		std::atomic_bool Running;
+		std::thread Thread;
+
+		void Serve();
+};
+
+#endif
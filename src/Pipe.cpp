@@ -1,4 +1,5 @@
 #include "Pipe.hpp"
+#include <algorithm>
 
 Pipe::Pipe() : FlowVolume(0) {}
 Pipe::Pipe(const Pipe& From)
@@ -23,6 +24,15 @@ void Pipe::Update(const SimulationVariables& Variables, float Height, float Heig
 	FlowVolume = std::max(0.0f, New);
 }
 
+// Distance is the distance between the cell centers, Width is how many PIPE_LENGTH wide the pipe is
+// Update(Variables, a, b) is the same as Update(Variables, a, b, Variables.PIPE_LENGTH, 1)
+void Pipe::Update(const SimulationVariables& Variables, float Height, float HeightOut, float Distance, float Width)
+{
+	float New = FlowVolume + Variables.DT * Variables.GRAVITY * (Height - HeightOut) * Width / Distance;
+
+	FlowVolume = std::max(0.0f, New);
+}
+
 void Pipe::ScaleBack(float K)
 {
 	FlowVolume *= K;
@@ -15,6 +15,7 @@ struct Pipe {
 	Pipe& operator = (const Pipe& From);
 
 	void Update(const SimulationVariables& Variables, float Height, float HeightOut);
+	void Update(const SimulationVariables& Variables, float Height, float HeightOut, float Distance, float Width);	// For pipes between cells of different sizes
 	void ScaleBack(float K);
 };
 
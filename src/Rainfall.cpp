@@ -0,0 +1,123 @@
+#include "Rainfall.hpp"
+#include <algorithm>
+#include <cmath>
+
+RainSource::RainSource(int SizeX, int SizeY) : SizeX(SizeX), SizeY(SizeY), SpringRows(SizeY + 1, 0) { }
+
+RainSource::~RainSource() { }
+
+void RainSource::SetMap(const float* From)
+{
+	if (!From)
+	{
+		Map.clear();
+		RowMax.clear();
+		return;
+	}
+
+	Map.assign(From, From + SizeX * SizeY);
+	RowMax.assign(SizeY, 0);
+	for (int y = 1; y < SizeY - 1; y++)
+		for (int x = 1; x < SizeX - 1; x++)
+		{
+			// Also takes NaN out
+			float& Scale = Map[x + y * SizeX];
+			Scale = Scale > 0 ? Scale : 0;
+			RowMax[y] = std::max(RowMax[y], Scale);
+		}
+}
+
+bool RainSource::AddSpring(const RainSpring& Spring)
+{
+	if (Spring.X < 1 || Spring.X > SizeX - 2 || Spring.Y < 1 || Spring.Y > SizeY - 2 || !(Spring.Rate >= 0))
+		return false;
+
+	auto At = std::upper_bound(Springs.begin(), Springs.end(), Spring, [](const RainSpring& A, const RainSpring& B) {
+		return A.Y < B.Y || (A.Y == B.Y && A.X < B.X);
+	});
+	Springs.insert(At, Spring);
+	for (int y = Spring.Y + 1; y <= SizeY; y++)
+		SpringRows[y]++;
+	return true;
+}
+
+void RainSource::ClearSprings()
+{
+	Springs.clear();
+	std::fill(SpringRows.begin(), SpringRows.end(), 0);
+}
+
+bool RainSource::IsUniform() const { return Map.empty() && Springs.empty(); }
+
+// Counter based (splitmix64), in (0, 1], the same step, row and draw always get the same number, no matter which thread gets there first
+static double GetRainRandom(long Step, int y, uint32_t Draw)
+{
+	uint64_t Z = (uint64_t)Step * 0x9E3779B97F4A7C15ull + (((uint64_t)y << 32) | Draw) * 0xD1B54A32D192ED03ull;
+	Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBull;
+	Z ^= Z >> 31;
+	return ((Z >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+RainRow::RainRow(const RainSource& Source, const SimulationVariables& Variables, long Step, int y) : X(Source.SizeX - 1), Height(0), Source(Source), MapRow(nullptr), MaxScale(1), Step(Step), Y(y), End(Source.SizeX - 1), Draw(0), LogMiss(0), DropHeight(0), DropX(Source.SizeX - 1), SpringScale(Variables.DT), Spring(Source.SpringRows[y]), SpringEnd(Source.SpringRows[y + 1]), FromSpring(false)
+{
+	if (!Source.Map.empty())
+	{
+		MapRow = Source.Map.data() + y * Source.SizeX;
+		MaxScale = Source.RowMax[y];
+	}
+
+	// A drop is all the rain of the cells it skipped, more drops once a cell of the map needs more than 10 * RainRandom times RAINFALL,
+	// at most one on every cell
+	double Chance = std::min(1.0, MaxScale / (10.0 * Variables.RainRandom));
+	if (Variables.RAINFALL > 0 && Chance > 0)
+	{
+		DropHeight = Variables.RAINFALL * MaxScale * Variables.DT / Chance;
+		LogMiss = std::log1p(-Chance);
+		DropX = 0;
+		NextDrop();
+	}
+	Pick();
+}
+
+void RainRow::Next()
+{
+	if (FromSpring)
+		Spring++;
+	else
+		NextDrop();
+	Pick();
+}
+
+// Every cell after the last drop gets one with the same chance, so the number of cells without one is geometric
+// With a chance of 1 LogMiss is -inf and every cell gets one
+void RainRow::NextDrop()
+{
+	while (true)
+	{
+		double Skip = std::floor(std::log(GetRainRandom(Step, Y, Draw++)) / LogMiss);
+		if (!(Skip < End - DropX - 1))
+		{
+			DropX = End;
+			return;
+		}
+		DropX += 1 + (int)Skip;
+		if (!MapRow || GetRainRandom(Step, Y, Draw++) * MaxScale <= MapRow[DropX])
+			return;
+	}
+}
+
+void RainRow::Pick()
+{
+	FromSpring = Spring < SpringEnd && Source.Springs[Spring].X <= DropX;
+	if (FromSpring)
+	{
+		X = Source.Springs[Spring].X;
+		Height = Source.Springs[Spring].Rate * SpringScale;
+	}
+	else
+	{
+		X = DropX;
+		Height = DropHeight;
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef RAINFALL_HPP
+#define RAINFALL_HPP
+
+#include <vector>
+#include <cstdint>
+#include "SimulationVariables.hpp"
+
+// Adds Rate water height per second to its cell every step, whatever RAINFALL is
+struct RainSpring
+{
+	int X;
+	int Y;
+	float Rate;
+};
+
+// Where the water of a SizeX x SizeY grid comes from, the ghost ring never gets any
+// One in 10 * RainRandom cells gets a drop every step, with all the rain of those cells, the cells that do are found by
+// skipping a geometric number of cells after the last drop, so a row costs as many random numbers as it has drops
+// A map scales RAINFALL per cell, a row then drops as often as its highest cell needs and every drop is kept
+// with the share of that its own cell has, so the rows that get nothing cost nothing
+// Only change it between steps, the rows read it while they finish
+class RainSource {
+	public:
+		RainSource(int SizeX, int SizeY);
+		RainSource(const RainSource& From) = delete;
+
+		~RainSource();
+
+		RainSource& operator = (const RainSource& From) = delete;
+
+		// Map is SizeX x SizeY and gets copied, 1 is RAINFALL, negative is 0, nullptr is 1 everywhere again
+		void SetMap(const float* Map);
+		// Returns false if it isn't inside the ghost ring or the rate is negative, springs on the same cell add up
+		bool AddSpring(const RainSpring& Spring);
+		void ClearSprings();
+		// No map and no springs, RAINFALL is all there is
+		bool IsUniform() const;
+
+	private:
+		friend class RainRow;
+
+		const int SizeX;
+		const int SizeY;
+
+		// Empty without a map
+		std::vector<float> Map;
+		std::vector<float> RowMax;
+
+		// Sorted by row and then x, the springs of row y are [SpringRows[y], SpringRows[y + 1])
+		std::vector<RainSpring> Springs;
+		std::vector<int> SpringRows;
+};
+
+// The cells of row y that get water in Step, in order of x, X is SizeX - 1 when there are none left
+// A cell can come up more than once, for a spring and a drop, or for every spring on it
+// The random numbers only depend on the step, the row and how many came before in the row, so the threads never change where it rains
+class RainRow {
+	public:
+		int X;
+		float Height;	// what it adds to the water height of X
+
+		RainRow(const RainSource& Source, const SimulationVariables& Variables, long Step, int y);
+
+		void Next();
+
+	private:
+		const RainSource& Source;
+		const float* MapRow;
+		float MaxScale;
+		long Step;
+		int Y;
+		int End;
+		uint32_t Draw;
+
+		double LogMiss;		// log of the chance a cell gets no drop
+		float DropHeight;
+		int DropX;
+
+		float SpringScale;
+		int Spring;
+		int SpringEnd;
+		bool FromSpring;
+
+		void NextDrop();
+		void Pick();
+};
+
+#endif
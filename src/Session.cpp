@@ -0,0 +1,215 @@
+#include "Session.hpp"
+#include <sstream>
+#include <string>
+#include <limits>
+
+static const char* const EventNames[] = { "rainfall", "max_step", "lod", "fill", "brush" };
+static const char* const ToolNames[] = { "flatten", "terrain", "sediment", "water" };
+
+template<class T, int N>
+static bool FindName(const char* const (&Names)[N], const std::string& Name, T& Out)
+{
+	for (int i = 0; i < N; i++)
+		if (Name == Names[i])
+		{
+			Out = (T)i;
+			return true;
+		}
+	return false;
+}
+
+bool SessionLog::Load(const char* Path)
+{
+	std::ifstream File(Path);
+	std::string Line;
+	if (!std::getline(File, Line))
+		return false;
+
+	std::istringstream Header(Line);
+	std::string Word;
+	int BoundaryIndex, TransportIndex;
+	if (!(Header >> Word >> SizeX >> SizeY >> DT >> BoundaryIndex >> TransportIndex) || Word != "session")
+		return false;
+	Boundary = (BoundaryPolicy)BoundaryIndex;
+	Transport = (SedimentTransport)TransportIndex;
+
+	Events.clear();
+	while (std::getline(File, Line))
+	{
+		std::istringstream In(Line);
+		if (Line.compare(0, 3, "end") == 0)
+			return (bool)(In >> Word >> Frames);
+
+		SessionEvent Event = SessionEvent();
+		if (!(In >> Event.Frame >> Event.Time >> Word) || !FindName(EventNames, Word, Event.Type))
+			return false;
+
+		if (Event.Type == SessionEvent::Rainfall || Event.Type == SessionEvent::MaxStep)
+			In >> Event.Value;
+		else if (Event.Type == SessionEvent::Brush)
+		{
+			BrushCommand& Stroke = Event.Stroke;
+			if (!(In >> Word) || !FindName(ToolNames, Word, Stroke.Tool))
+				return false;
+			In >> Stroke.X >> Stroke.Y >> Stroke.Range >> Stroke.Strength >> Stroke.Add >> Stroke.Remove;
+		}
+		if (In.fail())
+			return false;
+		Events.push_back(Event);
+	}
+
+	// A session that never got to write its end (it crashed) still replays up to its last event
+	Frames = Events.empty() ? 0 : Events.back().Frame + 1;
+	return true;
+}
+
+Session::Session(SimulationVariables& Variables, World2D& World, LODGrid2D& LOD) : Variables(Variables), World(World), LOD(LOD), UseLOD(false), Edited(false), LODAhead(false), Frame(0) { }
+
+Session::~Session()
+{
+	if (Log.is_open())
+		Log << "end " << Frame << std::endl;
+}
+
+bool Session::Record(const char* Path)
+{
+	Log.open(Path);
+	if (!Log.is_open())
+		return false;
+
+	// Enough digits that every float reads back as the same float
+	Log.precision(std::numeric_limits<float>::max_digits10);
+	StartTime = std::chrono::steady_clock::now();
+	Log << "session " << World.SizeX << " " << World.SizeY << " " << Variables.DT << " " << (int)Variables.Boundary << " " << (int)Variables.Transport << std::endl;
+
+	// The keys change these from whatever they start at, so the start goes in the log as well
+	SetRainfall(Variables.RAINFALL);
+	SetMaxStep(Variables.MAX_STEP);
+	return true;
+}
+
+void Session::Write(const SessionEvent& Event)
+{
+	if (!Log.is_open())
+		return;
+
+	Log << Event.Frame << " " << Event.Time << " " << EventNames[Event.Type];
+	if (Event.Type == SessionEvent::Rainfall || Event.Type == SessionEvent::MaxStep)
+		Log << " " << Event.Value;
+	else if (Event.Type == SessionEvent::Brush)
+	{
+		const BrushCommand& Stroke = Event.Stroke;
+		Log << " " << ToolNames[(int)Stroke.Tool] << " " << Stroke.X << " " << Stroke.Y << " " << Stroke.Range << " " << Stroke.Strength << " " << Stroke.Add << " " << Stroke.Remove;
+	}
+	Log << "\n";
+}
+
+double Session::Apply(const SessionEvent& Event)
+{
+	SessionEvent Recorded = Event;
+	Recorded.Frame = Frame;
+	Recorded.Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+	Write(Recorded);
+
+	switch (Event.Type)
+	{
+		case SessionEvent::Rainfall:
+			Variables.RAINFALL = Event.Value;
+			break;
+		case SessionEvent::MaxStep:
+			Variables.MAX_STEP = Event.Value;
+			break;
+		case SessionEvent::ToggleLOD:
+			UseLOD = !UseLOD;
+			if (UseLOD)
+				LOD.Rebuild(Variables);
+			else
+			{
+				Sync();
+				World.MarkAllUnstable();	// The adaptive grid changed the terrain without telling the World
+			}
+			break;
+		case SessionEvent::FillLakes:
+			if (!UseLOD)
+				return World.FillLakes(Variables);
+			break;
+		case SessionEvent::Brush:
+			World.QueueBrush(Event.Stroke);
+			Edited = true;
+			break;
+	}
+	return 0;
+}
+
+void Session::SetRainfall(float Value)
+{
+	SessionEvent Event = SessionEvent();
+	Event.Type = SessionEvent::Rainfall;
+	Event.Value = Value;
+	Apply(Event);
+}
+
+void Session::SetMaxStep(float Value)
+{
+	SessionEvent Event = SessionEvent();
+	Event.Type = SessionEvent::MaxStep;
+	Event.Value = Value;
+	Apply(Event);
+}
+
+void Session::ToggleLOD()
+{
+	SessionEvent Event = SessionEvent();
+	Event.Type = SessionEvent::ToggleLOD;
+	Apply(Event);
+}
+
+double Session::FillLakes()
+{
+	SessionEvent Event = SessionEvent();
+	Event.Type = SessionEvent::FillLakes;
+	return Apply(Event);
+}
+
+void Session::Brush(const BrushCommand& Stroke)
+{
+	SessionEvent Event = SessionEvent();
+	Event.Type = SessionEvent::Brush;
+	Event.Stroke = Stroke;
+	Apply(Event);
+}
+
+bool Session::Step()
+{
+	bool Fine = true;
+	if (UseLOD)
+	{
+		// The brushes edit the fine cells, so those have to be written first, and the nodes remade from them after
+		if (Edited)
+		{
+			Sync();
+			World.ApplyEdits();
+			LOD.Rebuild(Variables);
+		}
+		LOD.UpdateCells(Variables);
+		LODAhead = true;
+	}
+	else if (!World.IsBlownUp())
+		Fine = World.UpdateCells(Variables);
+	else
+		World.ApplyEdits();	// Stopped, but the brushes still work, and the queue doesn't grow
+
+	Edited = false;
+	Frame++;
+	return Fine;
+}
+
+void Session::Sync()
+{
+	if (LODAhead)
+		LOD.WriteBack();
+	LODAhead = false;
+}
+
+bool Session::IsUsingLOD() const { return UseLOD; }
+long Session::GetFrame() const { return Frame; }
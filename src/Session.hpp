@@ -0,0 +1,91 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include "SimulationVariables.hpp"
+#include "World2D.hpp"
+#include "LODGrid2D.hpp"
+#include "Brush.hpp"
+
+// Anything that changes a running 2D sim from outside, the hook turns the keys and the mouse into these
+struct SessionEvent
+{
+	enum Kind { Rainfall, MaxStep, ToggleLOD, FillLakes, Brush };
+
+	long Frame;
+	double Time;	// seconds since the recording started, only there for reading the log
+	Kind Type;
+	float Value;	// the new RAINFALL or MAX_STEP
+	BrushCommand Stroke;
+};
+
+// A recorded session, the text log is
+//	session <SizeX> <SizeY> <DT> <Boundary> <Transport>		(the enums as numbers)
+//	<frame> <time> rainfall|max_step <value>
+//	<frame> <time> lod|fill
+//	<frame> <time> brush flatten|terrain|sediment|water <x> <y> <range> <strength> <add> <remove>
+//	end <frames>
+struct SessionLog
+{
+	int SizeX = 0;
+	int SizeY = 0;
+	float DT = 0;
+	BoundaryPolicy Boundary = BoundaryPolicy::Closed;
+	SedimentTransport Transport = SedimentTransport::Flux;
+	long Frames = 0;
+	std::vector<SessionEvent> Events;	// in the order they happened
+
+	bool Load(const char* Path);
+};
+
+// A 2D sim run one frame at a time, the events of a frame are applied in order, then Step runs the frame
+// The rain only depends on the step (see World2D), so running the same events on the same terrain gives the same cells,
+// thats what a replay does, without a window and as fast as it can
+class Session {
+	public:
+		Session(SimulationVariables& Variables, World2D& World, LODGrid2D& LOD);
+		Session(const Session& From) = delete;
+
+		~Session();
+
+		Session& operator = (const Session& From) = delete;
+
+		// Writes every event from now on to Path, call it before the first Step, returns false if it can't be opened
+		bool Record(const char* Path);
+
+		// Returns the volume that drained over the edge for FillLakes, 0 for the rest
+		double Apply(const SessionEvent& Event);
+
+		void SetRainfall(float Value);
+		void SetMaxStep(float Value);
+		void ToggleLOD();
+		double FillLakes();
+		void Brush(const BrushCommand& Stroke);
+
+		// The step of the frame, on the LOD grid or on the World, returns false if the World blew up this frame
+		// The LOD grid doesn't write the cells back, thats a pass over every fine cell, see Sync
+		bool Step();
+		// Writes the LOD grid back into the cells if it stepped since the last time, call it before reading them (drawing, hashing)
+		void Sync();
+
+		bool IsUsingLOD() const;
+		long GetFrame() const;
+
+	private:
+		SimulationVariables& Variables;
+		World2D& World;
+		LODGrid2D& LOD;
+		bool UseLOD;
+		bool Edited;	// a brush was queued this frame
+		bool LODAhead;	// the LOD grid stepped since it last wrote the cells
+		long Frame;
+
+		std::ofstream Log;
+		std::chrono::steady_clock::time_point StartTime;
+
+		void Write(const SessionEvent& Event);
+};
+
+#endif
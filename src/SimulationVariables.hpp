@@ -4,6 +4,21 @@
 #include <ostream>
 #include <cmath>
 
+// What happens at the edge of the grid, the outer ring of cells are ghost cells that get filled every step
+enum class BoundaryPolicy {
+	Closed,		// a wall, nothing flows out
+	Open,		// water and sediment flow out over the edge and are gone
+	Periodic	// flowing out one side flows in on the other
+};
+
+// How the sediment moves with the water
+enum class SedimentTransport {
+	Flux,			// every pipe takes the share of the sediment that it takes of the water, spreads it out and needs a small DT
+	SemiLagrangian,	// a cell takes the sediment of the point its flow came from, stays sharp, but doesn't conserve it exactly
+					// never from further than the next cell, so it needs the same DT as the pipes, not a bigger one
+	MacCormack		// SemiLagrangian traced back again to correct it, less smearing for the same DT
+};
+
 struct SimulationVariables {
 	float RAINFALL = 0.4f;
 	float EVAPORATION = 0.025f;
@@ -15,6 +30,15 @@ struct SimulationVariables {
 	float DEPOSITION_CONSTANT = 10.0f;
 	float MAX_STEP = std::tan(60 * M_PI / 180);
 	int RainRandom = 10;
+	BoundaryPolicy Boundary = BoundaryPolicy::Closed;
+	SedimentTransport Transport = SedimentTransport::Flux;
+
+	// Adaptive grid (LODGrid2D), a block is refined when any of these is exceeded, and simulated coarser the further below them it stays
+	float LOD_DEPTH = 0.05f;		// water + sediment height
+	float LOD_FLUX = 0.05f;			// outgoing flux of a cell
+	float LOD_CURVATURE = 2.0f;		// laplacian of the terrain height
+	int LOD_MAX_LEVEL = 3;			// coarsest nodes are 2^LOD_MAX_LEVEL cells wide
+	int LOD_REGRID_INTERVAL = 20;	// steps between picking new levels
 };
 
 #endif
@@ -0,0 +1,73 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int NumThreads) : Job(nullptr), JobData(nullptr), Generation(0), Running(0), Stop(false)
+{
+	if (NumThreads <= 0)
+		NumThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (int i = 1; i < NumThreads; i++)
+		Threads.push_back(std::thread([this, i]() { WorkerLoop(i); }));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Stop = true;
+	}
+	StartCondition.notify_all();
+
+	for (size_t i = 0; i < Threads.size(); i++)
+		Threads[i].join();
+}
+
+int ThreadPool::GetNumThreads() const { return Threads.size() + 1; }
+
+void ThreadPool::RunJob(void (*NewJob)(void*, int), void* NewJobData)
+{
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Job = NewJob;
+		JobData = NewJobData;
+		Running = Threads.size();
+		Generation++;
+	}
+	StartCondition.notify_all();
+
+	NewJob(NewJobData, 0);
+
+	std::unique_lock<std::mutex> Lock(Mutex);
+	DoneCondition.wait(Lock, [this]() { return Running == 0; });
+}
+
+void ThreadPool::WorkerLoop(int ThreadIndex)
+{
+	int SeenGeneration = 0;
+
+	while (true)
+	{
+		void (*CurrentJob)(void*, int);
+		void* CurrentJobData;
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			StartCondition.wait(Lock, [&]() { return Stop || Generation != SeenGeneration; });
+			if (Stop)
+				return;
+
+			SeenGeneration = Generation;
+			CurrentJob = Job;
+			CurrentJobData = JobData;
+		}
+
+		CurrentJob(CurrentJobData, ThreadIndex);
+
+		bool Last;
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			Last = --Running == 0;
+		}
+		if (Last)
+			DoneCondition.notify_one();
+	}
+}
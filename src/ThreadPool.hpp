@@ -0,0 +1,78 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// Threads that stay alive between calls, so a step doesn't have to start and join threads for every pass
+// The calling thread joins in as thread 0
+class ThreadPool {
+	public:
+		ThreadPool(int NumThreads = 0);	// 0 = std::thread::hardware_concurrency()
+		ThreadPool(const ThreadPool& From) = delete;
+
+		~ThreadPool();
+
+		ThreadPool& operator = (const ThreadPool& From) = delete;
+
+		int GetNumThreads() const;
+
+		// Calls Func(ThreadIndex) once on every thread, returns when all of them are done
+		template<class T>
+		void Run(T& Func)
+		{
+			RunJob(&CallJob<T>, &Func);
+		}
+
+		// Calls Func(i) for every i in [StartIndex, EndIndex), the threads take the next index whenever they are done with one
+		template<class T>
+		void ParallelFor(int StartIndex, int EndIndex, T Func)
+		{
+			std::atomic_int Current(StartIndex);
+			auto Job = [&](int ThreadIndex) {
+				for (int i = Current.fetch_add(1); i < EndIndex; i = Current.fetch_add(1))
+					Func(i);
+			};
+			Run(Job);
+		}
+
+		// Same, but the threads take ChunkSize indices at a time, for when one index is too little work to be worth the atomic
+		template<class T>
+		void ParallelFor(int StartIndex, int EndIndex, int ChunkSize, T Func)
+		{
+			int NumChunks = (EndIndex - StartIndex + ChunkSize - 1) / ChunkSize;
+			ParallelFor(0, NumChunks, [&](int Chunk) {
+				int ChunkStart = StartIndex + Chunk * ChunkSize;
+				int ChunkEnd = std::min(ChunkStart + ChunkSize, EndIndex);
+				for (int i = ChunkStart; i < ChunkEnd; i++)
+					Func(i);
+			});
+		}
+
+	private:
+		std::vector<std::thread> Threads;
+		std::mutex Mutex;
+		std::condition_variable StartCondition;
+		std::condition_variable DoneCondition;
+
+		void (*Job)(void*, int);
+		void* JobData;
+		int Generation;
+		int Running;
+		bool Stop;
+
+		template<class T>
+		static void CallJob(void* Data, int ThreadIndex)
+		{
+			(*(T*)Data)(ThreadIndex);
+		}
+
+		void RunJob(void (*NewJob)(void*, int), void* NewJobData);
+		void WorkerLoop(int ThreadIndex);
+};
+
+#endif
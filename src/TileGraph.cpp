@@ -0,0 +1,119 @@
+#include "TileGraph.hpp"
+
+TileGraph::TileGraph() : NumTiles(0), NumPhases(0), Wrap(false), Steps(0), QueueStart(0), QueueCount(0), Remaining(0) { }
+
+TileGraph::~TileGraph() { }
+
+void TileGraph::Setup(int NewNumTiles, int NewNumPhases, bool NewWrap)
+{
+	NumTiles = NewNumTiles;
+	NumPhases = NewNumPhases;
+	Wrap = NewWrap && NumTiles > 2;
+
+	Done.reset(new std::atomic_int[NumTiles * NumPhases]);
+	Claimed.reset(new std::atomic_int[NumTiles * NumPhases]);
+	Queue.resize(NumTiles * NumPhases);
+}
+
+// The tile itself is always the first
+int TileGraph::GetNeighbours(int Tile, int* Out) const
+{
+	int Count = 0;
+	Out[Count++] = Tile;
+
+	if (Tile > 0)
+		Out[Count++] = Tile - 1;
+	else if (Wrap)
+		Out[Count++] = NumTiles - 1;
+
+	if (Tile < NumTiles - 1)
+		Out[Count++] = Tile + 1;
+	else if (Wrap)
+		Out[Count++] = 0;
+
+	return Count;
+}
+
+bool TileGraph::IsReady(int Tile, int Phase, int Step) const
+{
+	int Neighbours[3];
+	int Count = GetNeighbours(Tile, Neighbours);
+
+	for (int i = 0; i < Count; i++)
+	{
+		int Other = Neighbours[i];
+		if (Phase > 0 && Done[Other * NumPhases + Phase - 1] < Step + 1)
+			return false;
+		if (Phase == 0 && Done[Other * NumPhases + NumPhases - 1] < Step)
+			return false;
+	}
+	return true;
+}
+
+// Only the one that claims the step gets to push it, no matter how many neighbours finish at the same time
+void TileGraph::TryPush(int Tile, int Phase)
+{
+	std::atomic_int& Next = Claimed[Tile * NumPhases + Phase];
+
+	int Step = Next;
+	if (Step >= Steps || !IsReady(Tile, Phase, Step))
+		return;
+	if (!Next.compare_exchange_strong(Step, Step + 1))
+		return;
+
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Queue[(QueueStart + QueueCount) % Queue.size()] = Task{ Step, Tile, Phase };
+		QueueCount++;
+	}
+	Condition.notify_one();
+}
+
+void TileGraph::Reset(int NewSteps)
+{
+	Steps = NewSteps;
+	Remaining = Steps * NumTiles * NumPhases;
+	QueueStart = 0;
+	QueueCount = 0;
+
+	for (int i = 0; i < NumTiles * NumPhases; i++)
+	{
+		Done[i] = 0;
+		Claimed[i] = 0;
+	}
+
+	for (int Tile = 0; Tile < NumTiles; Tile++)
+		TryPush(Tile, 0);
+}
+
+bool TileGraph::Pop(Task& Out)
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	Condition.wait(Lock, [this]() { return QueueCount > 0 || Remaining == 0; });
+	if (QueueCount == 0)
+		return false;
+
+	Out = Queue[QueueStart];
+	QueueStart = (QueueStart + 1) % Queue.size();
+	QueueCount--;
+	return true;
+}
+
+void TileGraph::Complete(const Task& Finished)
+{
+	Done[Finished.Tile * NumPhases + Finished.Phase] = Finished.Step + 1;
+
+	int NextPhase = (Finished.Phase + 1) % NumPhases;
+	int Neighbours[3];
+	int Count = GetNeighbours(Finished.Tile, Neighbours);
+	for (int i = 0; i < Count; i++)
+		TryPush(Neighbours[i], NextPhase);
+
+	bool Last;
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		Last = --Remaining == 0;
+	}
+	if (Last)
+		Condition.notify_all();
+}
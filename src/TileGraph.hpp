@@ -0,0 +1,87 @@
+#ifndef TILEGRAPH_HPP
+#define TILEGRAPH_HPP
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cassert>
+#include "ThreadPool.hpp"
+
+// Runs every phase of every tile for a number of steps, without a barrier between the phases
+// Phase P of a tile can run as soon as the phase before it (or the last phase of the step before) is done for the tile and its neighbours,
+// so tiles that are done early start on the next phase, or the next step, while slow tiles catch up
+// The tiles are bands of rows, the neighbours are the bands above and below, Wrap makes the first and the last band neighbours
+class TileGraph {
+	public:
+		TileGraph();
+		TileGraph(const TileGraph& From) = delete;
+
+		~TileGraph();
+
+		TileGraph& operator = (const TileGraph& From) = delete;
+
+		void Setup(int NumTiles, int NumPhases, bool Wrap);
+
+		// Kernel(Step, Tile, Phase), negative Steps would never get to 0 remaining tasks and wait forever
+		template<class T>
+		void Run(ThreadPool& Pool, int Steps, T Kernel)
+		{
+			assert(Steps >= 0);
+			Reset(Steps);
+
+			auto Worker = [&](int ThreadIndex) {
+				Task Current;
+				while (Pop(Current))
+				{
+					Kernel(Current.Step, Current.Tile, Current.Phase);
+					Complete(Current);
+				}
+			};
+			Pool.Run(Worker);
+		}
+
+		// Same order of work, but every phase waits for all tiles of the phase before, used to compare against
+		template<class T>
+		void RunBarrier(ThreadPool& Pool, int Steps, T Kernel)
+		{
+			for (int Step = 0; Step < Steps; Step++)
+				for (int Phase = 0; Phase < NumPhases; Phase++)
+					Pool.ParallelFor(0, NumTiles, [&](int Tile) { Kernel(Step, Tile, Phase); });
+		}
+
+	private:
+		struct Task
+		{
+			int Step;
+			int Tile;
+			int Phase;
+		};
+
+		int NumTiles;
+		int NumPhases;
+		bool Wrap;
+		int Steps;
+
+		// Per tile and phase, how many steps are done, and the next step that is (or was) put in the queue
+		std::unique_ptr<std::atomic_int[]> Done;
+		std::unique_ptr<std::atomic_int[]> Claimed;
+
+		// At most one task per tile and phase is ever waiting, so the queue never has to grow
+		std::vector<Task> Queue;
+		size_t QueueStart;
+		size_t QueueCount;
+		int Remaining;
+		std::mutex Mutex;
+		std::condition_variable Condition;
+
+		int GetNeighbours(int Tile, int* Out) const;
+		bool IsReady(int Tile, int Phase, int Step) const;
+		void TryPush(int Tile, int Phase);
+		void Reset(int NewSteps);
+		bool Pop(Task& Out);
+		void Complete(const Task& Finished);
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "WaterSim.h"
+#include "SimulationVariables.hpp"
+#include "Cell1D.hpp"
+#include "Cell2D.hpp"
+#include "World2D.hpp"
+#include "Brush.hpp"
+#include <memory>
+#include <vector>
+#include <exception>
+
+// Exactly one of the grids is there, the 1D one has no World, it steps with Cell1D::UpdateCells
+struct watersim_world
+{
+	SimulationVariables Variables;
+	int SizeX = 0;
+	int SizeY = 0;
+	std::unique_ptr<Cell1D[]> Cells1D;
+	std::unique_ptr<float[]> Scratch1D;
+	std::unique_ptr<Cell2D[]> Cells2D;
+	std::unique_ptr<World2D> World;
+	bool BlownUp1D = false;
+};
+
+static void ToC(const SimulationVariables& Variables, watersim_variables_t* Out)
+{
+	Out->rainfall = Variables.RAINFALL;
+	Out->evaporation = Variables.EVAPORATION;
+	Out->dt = Variables.DT;
+	Out->gravity = Variables.GRAVITY;
+	Out->pipe_length = Variables.PIPE_LENGTH;
+	Out->sediment_capacity = Variables.SEDIMENT_CAPACITY;
+	Out->dissolve_constant = Variables.DISSOLVE_CONSTANT;
+	Out->deposition_constant = Variables.DEPOSITION_CONSTANT;
+	Out->max_step = Variables.MAX_STEP;
+	Out->rain_random = Variables.RainRandom;
+	Out->boundary = (watersim_boundary_t)Variables.Boundary;
+	Out->transport = (watersim_transport_t)Variables.Transport;
+}
+
+// Nothing may throw through a C caller, whatever does (running out of memory or threads) is -1
+template<class T>
+static int32_t Catch(T Function)
+{
+	try
+	{
+		return Function();
+	}
+	catch (const std::exception&)
+	{
+		return -1;
+	}
+}
+
+int32_t watersim_abi_version(void)
+{
+	return WATERSIM_ABI_VERSION;
+}
+
+// Nothing may throw through a C caller, running out of memory (or threads) is a NULL world
+watersim_world_t* watersim_create_1d(int32_t size)
+{
+	if (size < 3)
+		return nullptr;
+
+	try
+	{
+		std::unique_ptr<watersim_world_t> World(new watersim_world_t());
+		World->SizeX = size;
+		World->SizeY = 1;
+		World->Cells1D.reset(new Cell1D[size]);
+		World->Scratch1D.reset(new float[Cell1D::GetScratchSize(size)]);
+		return World.release();
+	}
+	catch (const std::exception&)
+	{
+		return nullptr;
+	}
+}
+
+watersim_world_t* watersim_create_2d(int32_t size_x, int32_t size_y, int32_t threads)
+{
+	if (size_x < 3 || size_y < 3)
+		return nullptr;
+
+	try
+	{
+		std::unique_ptr<watersim_world_t> World(new watersim_world_t());
+		World->SizeX = size_x;
+		World->SizeY = size_y;
+		World->Cells2D.reset(new Cell2D[(size_t)size_x * size_y]);
+		World->World.reset(new World2D(World->Cells2D.get(), size_x, size_y, threads));
+		return World.release();
+	}
+	catch (const std::exception&)
+	{
+		return nullptr;
+	}
+}
+
+void watersim_destroy(watersim_world_t* world)
+{
+	delete world;
+}
+
+void watersim_default_variables(watersim_variables_t* out)
+{
+	ToC(SimulationVariables(), out);
+}
+
+void watersim_get_variables(const watersim_world_t* world, watersim_variables_t* out)
+{
+	ToC(world->Variables, out);
+}
+
+int32_t watersim_set_variables(watersim_world_t* world, const watersim_variables_t* variables)
+{
+	// Enums from C can be any int, nothing is changed if one isn't a value of its enum
+	if ((int)variables->boundary < WATERSIM_BOUNDARY_CLOSED || (int)variables->boundary > WATERSIM_BOUNDARY_PERIODIC
+		|| (int)variables->transport < WATERSIM_TRANSPORT_FLUX || (int)variables->transport > WATERSIM_TRANSPORT_MACCORMACK)
+		return -1;
+
+	SimulationVariables& Variables = world->Variables;
+	Variables.RAINFALL = variables->rainfall;
+	Variables.EVAPORATION = variables->evaporation;
+	Variables.DT = variables->dt;
+	Variables.GRAVITY = variables->gravity;
+	Variables.PIPE_LENGTH = variables->pipe_length;
+	Variables.SEDIMENT_CAPACITY = variables->sediment_capacity;
+	Variables.DISSOLVE_CONSTANT = variables->dissolve_constant;
+	Variables.DEPOSITION_CONSTANT = variables->deposition_constant;
+	Variables.MAX_STEP = variables->max_step;
+	Variables.RainRandom = variables->rain_random > 0 ? variables->rain_random : 1;
+	Variables.Boundary = (BoundaryPolicy)variables->boundary;
+	Variables.Transport = (SedimentTransport)variables->transport;
+	return 0;
+}
+
+int32_t watersim_step(watersim_world_t* world, int32_t steps)
+{
+	if (steps < 0)
+		return -1;
+
+	return Catch([&]() -> int32_t {
+		if (world->World)
+			return world->World->UpdateCells(world->Variables, steps) ? 0 : -1;
+
+		// Same check the World does at the end of every step, but only once per call
+		if (world->BlownUp1D)
+			return -1;
+		for (int i = 0; i < steps; i++)
+			Cell1D::UpdateCells(world->Variables, world->Cells1D.get(), world->SizeX, world->Scratch1D.get());
+
+		Diagnostics Stats;
+		for (int i = 1; i < world->SizeX - 1; i++)
+			Stats.Add(world->Cells1D[i], world->Cells1D[i].Cell1D::GetVelocityMagnitude(), i);
+		world->BlownUp1D = Stats.IsBlownUp();
+		return world->BlownUp1D ? -1 : 0;
+	});
+}
+
+void watersim_clear_blow_up(watersim_world_t* world)
+{
+	if (world->World)
+		world->World->ClearBlowUp();
+	world->BlownUp1D = false;
+}
+
+// The cells are structs, so a field is every CellSize bytes, starting at the member of the first cell
+static void MakeField(float* First, size_t CellSize, int SizeX, int SizeY, watersim_field_t* Out)
+{
+	Out->data = First;
+	Out->stride_x = CellSize;
+	Out->stride_y = CellSize * SizeX;
+	Out->size_x = SizeX;
+	Out->size_y = SizeY;
+}
+
+int32_t watersim_get_field(watersim_world_t* world, watersim_field_kind_t kind, watersim_field_t* out)
+{
+	if (world->Cells2D)
+	{
+		Cell2D& First = world->Cells2D[0];
+		float* Planes[] = { &First.TerrainHeight, &First.WaterHeight, &First.Sediment, &First.Velocity.first, &First.Velocity.second };
+		if ((int)kind < 0 || kind > WATERSIM_FIELD_VELOCITY_Y)
+			return -1;
+		MakeField(Planes[kind], sizeof(Cell2D), world->SizeX, world->SizeY, out);
+		return 0;
+	}
+
+	Cell1D& First = world->Cells1D[0];
+	float* Planes[] = { &First.TerrainHeight, &First.WaterHeight, &First.Sediment, &First.Velocity };
+	if ((int)kind < 0 || kind > WATERSIM_FIELD_VELOCITY_X)
+		return -1;
+	MakeField(Planes[kind], sizeof(Cell1D), world->SizeX, 1, out);
+	return 0;
+}
+
+void watersim_terrain_changed(watersim_world_t* world, int32_t start_x, int32_t start_y, int32_t end_x, int32_t end_y)
+{
+	if (world->World)
+		world->World->MarkTerrainChanged(start_x, start_y, end_x, end_y);
+}
+
+int32_t watersim_brush(watersim_world_t* world, const watersim_brush_t* brush)
+{
+	if (!world->World || brush->x < 0 || brush->y < 0 || brush->x >= world->SizeX || brush->y >= world->SizeY)
+		return -1;
+	if ((int)brush->tool < WATERSIM_BRUSH_FLATTEN || (int)brush->tool > WATERSIM_BRUSH_WATER)
+		return -1;
+
+	BrushCommand Command;
+	Command.Tool = (BrushTool)brush->tool;
+	Command.X = brush->x;
+	Command.Y = brush->y;
+	Command.Range = brush->range;
+	Command.Strength = brush->strength;
+	Command.Add = brush->add;
+	Command.Remove = brush->remove;
+	return Catch([&]() -> int32_t {
+		world->World->QueueBrush(Command);
+		return 0;
+	});
+}
+
+int32_t watersim_set_rain_map(watersim_world_t* world, const watersim_field_t* map)
+{
+	if (!world->World)
+		return -1;
+	if (!map)
+	{
+		world->World->SetRainMap(nullptr);
+		return 0;
+	}
+	if (map->size_x != world->SizeX || map->size_y != world->SizeY)
+		return -1;
+
+	return Catch([&]() -> int32_t {
+		std::vector<float> Map((size_t)world->SizeX * world->SizeY);
+		for (int y = 0; y < world->SizeY; y++)
+			for (int x = 0; x < world->SizeX; x++)
+				Map[x + y * world->SizeX] = *(const float*)((const char*)map->data + x * map->stride_x + y * map->stride_y);
+		world->World->SetRainMap(Map.data());
+		return 0;
+	});
+}
+
+int32_t watersim_add_spring(watersim_world_t* world, int32_t x, int32_t y, float rate)
+{
+	if (!world->World)
+		return -1;
+	return Catch([&]() -> int32_t { return world->World->AddSpring(x, y, rate) ? 0 : -1; });
+}
+
+void watersim_clear_springs(watersim_world_t* world)
+{
+	if (world->World)
+		world->World->ClearSprings();
+}
@@ -0,0 +1,134 @@
+#ifndef WATERSIM_H
+#define WATERSIM_H
+
+/*
+ * C interface of the solver, what libwatersim.so exports (make lib), no graphics needed
+ *
+ * A world is a grid of cells with a ring of ghost cells around it (see SimulationVariables.hpp for the boundary),
+ * so a 2D world of size_x * size_y has (size_x - 2) * (size_y - 2) cells that are simulated, a 1D one size - 2
+ * New worlds are flat, dry and empty, write the terrain through a field and step it
+ * The fields point straight into the cells, nothing is copied, they stay valid until the world is destroyed
+ * Never write to them while a step runs
+ * Nothing throws, whatever can fail (also by running out of memory) returns -1 or NULL
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WATERSIM_ABI_VERSION 2
+
+typedef struct watersim_world watersim_world_t;
+
+typedef enum watersim_boundary
+{
+	WATERSIM_BOUNDARY_CLOSED,
+	WATERSIM_BOUNDARY_OPEN,
+	WATERSIM_BOUNDARY_PERIODIC
+}	watersim_boundary_t;
+
+typedef enum watersim_transport
+{
+	WATERSIM_TRANSPORT_FLUX,
+	WATERSIM_TRANSPORT_SEMI_LAGRANGIAN,
+	WATERSIM_TRANSPORT_MACCORMACK
+}	watersim_transport_t;
+
+typedef enum watersim_field_kind
+{
+	WATERSIM_FIELD_TERRAIN,
+	WATERSIM_FIELD_WATER,
+	WATERSIM_FIELD_SEDIMENT,
+	WATERSIM_FIELD_VELOCITY_X,	/* read only */
+	WATERSIM_FIELD_VELOCITY_Y	/* read only, 2D only */
+}	watersim_field_kind_t;
+
+typedef enum watersim_brush_tool
+{
+	WATERSIM_BRUSH_FLATTEN,
+	WATERSIM_BRUSH_TERRAIN,
+	WATERSIM_BRUSH_SEDIMENT,
+	WATERSIM_BRUSH_WATER
+}	watersim_brush_tool_t;
+
+/* Same fields and defaults as SimulationVariables */
+typedef struct watersim_variables
+{
+	float				rainfall;
+	float				evaporation;
+	float				dt;
+	float				gravity;
+	float				pipe_length;
+	float				sediment_capacity;
+	float				dissolve_constant;
+	float				deposition_constant;
+	float				max_step;
+	int32_t				rain_random;
+	watersim_boundary_t	boundary;
+	watersim_transport_t	transport;
+}	watersim_variables_t;
+
+/* Cell (x, y) of a field is at (char*)data + x * stride_x + y * stride_y, the strides are in bytes */
+typedef struct watersim_field
+{
+	float*		data;
+	ptrdiff_t	stride_x;
+	ptrdiff_t	stride_y;
+	int32_t		size_x;
+	int32_t		size_y;
+}	watersim_field_t;
+
+typedef struct watersim_brush
+{
+	watersim_brush_tool_t	tool;
+	int32_t					x;
+	int32_t					y;
+	int32_t					range;
+	float					strength;
+	int32_t					add;		/* raise, or add */
+	int32_t					remove;		/* lower, or take away */
+}	watersim_brush_t;
+
+/* Returns WATERSIM_ABI_VERSION of the library, check it against the one of the header */
+int32_t				watersim_abi_version(void);
+
+/* NULL if the size is too small (3 including the ghosts) or there isn't enough memory, threads 0 is one per core */
+watersim_world_t*	watersim_create_1d(int32_t size);
+watersim_world_t*	watersim_create_2d(int32_t size_x, int32_t size_y, int32_t threads);
+void				watersim_destroy(watersim_world_t* world);
+
+void				watersim_default_variables(watersim_variables_t* out);
+void				watersim_get_variables(const watersim_world_t* world, watersim_variables_t* out);
+/* Returns 0, or -1 and changes nothing if boundary or transport isn't one of its values */
+int32_t				watersim_set_variables(watersim_world_t* world, const watersim_variables_t* variables);
+
+/* Runs steps steps in one call, returns 0, or -1 if the grid blew up (NaN or negative cells), it won't step again until then
+ * Also -1 for negative steps, or if it ran out of memory */
+int32_t				watersim_step(watersim_world_t* world, int32_t steps);
+void				watersim_clear_blow_up(watersim_world_t* world);
+
+/* Returns 0, or -1 if the world doesn't have that field */
+int32_t				watersim_get_field(watersim_world_t* world, watersim_field_kind_t kind, watersim_field_t* out);
+
+/* After writing terrain through a field, the cells in [start, end) might slump again (2D, the 1D world checks every cell anyway) */
+void				watersim_terrain_changed(watersim_world_t* world, int32_t start_x, int32_t start_y, int32_t end_x, int32_t end_y);
+
+/* The brushes of the viewer, queued and applied at the start of the next step, returns 0, or -1 for a 1D world,
+ * a cell outside the world or a tool that isn't one */
+int32_t				watersim_brush(watersim_world_t* world, const watersim_brush_t* brush);
+
+/* Scales rainfall per cell, 1 is rainfall, the map is copied, NULL rains the same everywhere again (2D, only between steps)
+ * Returns 0, or -1 for a 1D world or a map that isn't the size of the world */
+int32_t				watersim_set_rain_map(watersim_world_t* world, const watersim_field_t* map);
+/* Adds rate water height per second to cell x, y every step, returns 0, or -1 for a 1D world, a ghost cell or a negative rate */
+int32_t				watersim_add_spring(watersim_world_t* world, int32_t x, int32_t y, float rate);
+void				watersim_clear_springs(watersim_world_t* world);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,573 @@
+#include "World2D.hpp"
+#include "Advection.hpp"
+#include <algorithm>
+#include <chrono>
+
+// Where a brush could have changed the slopes, in EditedTiles
+static const uint8_t TERRAIN_EDIT = 2;
+
+World2D::World2D(Cell2D* Cells, int SizeX, int SizeY, int NumThreads, int RowsPerTile) : Cells(Cells), SizeX(SizeX), SizeY(SizeY), Pool(NumThreads), RowsPerTile(std::max(1, RowsPerTile)), GraphWraps(false), Stats(nullptr), BlownUp(false), StepCount(0), SeedMaxStep(-1), SeedPipeLength(-1), SeedBoundary(BoundaryPolicy::Closed), Rain(SizeX, SizeY), EndStep(0)
+{
+	NumTiles = (SizeY - 2 + this->RowsPerTile - 1) / this->RowsPerTile;
+	TileStats.reset(new TileDiagnostics[NumTiles]);
+	Scratch.reset(new CellUpdate[NumTiles * 3 * SizeX]);
+	for (int Set = 0; Set < 2; Set++)
+	{
+		Unstable[Set].reset(new std::atomic<uint8_t>[SizeX * SizeY]);
+		UnstableRows[Set].reset(new std::atomic<uint8_t>[SizeY]);
+		for (int i = 0; i < SizeX * SizeY; i++)
+			Unstable[Set][i].store(0, std::memory_order_relaxed);
+		for (int y = 0; y < SizeY; y++)
+			UnstableRows[Set][y].store(0, std::memory_order_relaxed);
+	}
+	Graph.Setup(NumTiles, NumPhases, GraphWraps);
+
+	EditedTiles.reset(new uint8_t[NumTiles]());
+	DirtyTiles.reset(new uint8_t[NumTiles]);
+	std::fill(DirtyTiles.get(), DirtyTiles.get() + NumTiles, 1);
+
+	// Room for a few frames of strokes, more only allocates once
+	Edits.reserve(64);
+	Applying.reserve(64);
+	EditTargets.reserve(64);
+}
+
+World2D::~World2D() { }
+
+void World2D::SetMetrics(Metrics* Source)
+{
+	Stats = Source;
+	if (!Stats)
+		return;
+
+	double Start = 0;
+	for (int y = 1; y < SizeY - 1; y++)
+		for (int x = 1; x < SizeX - 1; x++)
+			Start += (double)Cells[x + y * SizeX].TerrainHeight + Cells[x + y * SizeX].Sediment;
+	Stats->Setup(NumTiles, (SizeX - 2) * (SizeY - 2), Start);
+}
+
+Diagnostics World2D::GetDiagnostics() const
+{
+	Diagnostics Out;
+	for (int i = 0; i < NumTiles; i++)
+		Out.Merge(TileStats[i].Stats);
+	return Out;
+}
+
+bool World2D::IsBlownUp() const { return BlownUp; }
+
+void World2D::ClearBlowUp()
+{
+	// The steps that were skipped didn't keep the unstable cells up to date
+	BlownUp = false;
+	MarkAllUnstable();
+}
+
+// Marks x, y and the 8 cells next to it, with Wrap the ghosts are copies of the other side, so that side is marked instead
+void World2D::MarkAround(int Set, int x, int y, bool Wrap)
+{
+	for (int dy = -1; dy <= 1; dy++)
+	{
+		int ny = y + dy;
+		if (ny < 1 || ny > SizeY - 2)
+		{
+			if (!Wrap)
+				continue;
+			ny = ny < 1 ? SizeY - 2 : 1;
+		}
+
+		for (int dx = -1; dx <= 1; dx++)
+		{
+			int nx = x + dx;
+			if (nx < 1 || nx > SizeX - 2)
+			{
+				if (!Wrap)
+					continue;
+				nx = nx < 1 ? SizeX - 2 : 1;
+			}
+			Unstable[Set][nx + ny * SizeX].store(1, std::memory_order_relaxed);
+		}
+		UnstableRows[Set][ny].store(1, std::memory_order_relaxed);
+	}
+}
+
+double World2D::FillLakes(const SimulationVariables& Variables)
+{
+	ApplyEdits();
+	std::fill(DirtyTiles.get(), DirtyTiles.get() + NumTiles, 1);
+	return Lakes.Solve(Variables, Cells, SizeX, SizeY);
+}
+
+void World2D::QueueBrush(const BrushCommand& Command)
+{
+	std::lock_guard<std::mutex> Lock(EditMutex);
+	Edits.push_back(Command);
+}
+
+void World2D::ApplyEdits()
+{
+	{
+		std::lock_guard<std::mutex> Lock(EditMutex);
+		std::swap(Edits, Applying);
+	}
+	std::fill(EditedTiles.get(), EditedTiles.get() + NumTiles, 0);
+	if (Applying.empty())
+		return;
+
+	// One after the other for the center of every Flatten, the same order as the rows get them in below
+	int LowY = SizeY;
+	int HighY = 0;
+	EditTargets.resize(Applying.size());
+	for (size_t i = 0; i < Applying.size(); i++)
+	{
+		const BrushCommand& Command = Applying[i];
+		int CommandLowX, CommandLowY, CommandHighX, CommandHighY;
+		GetBrushBounds(Command, SizeX, SizeY, CommandLowX, CommandLowY, CommandHighX, CommandHighY);
+		LowY = std::min(LowY, CommandLowY);
+		HighY = std::max(HighY, CommandHighY);
+
+		if (Command.Tool == BrushTool::Flatten)
+		{
+			Cell2D Center = Cells[Command.X + Command.Y * SizeX];
+			for (size_t j = 0; j < i; j++)
+			{
+				int PrevLowX, PrevLowY, PrevHighX, PrevHighY;
+				GetBrushBounds(Applying[j], SizeX, SizeY, PrevLowX, PrevLowY, PrevHighX, PrevHighY);
+				if (Command.X >= PrevLowX && Command.X < PrevHighX && Command.Y >= PrevLowY && Command.Y < PrevHighY)
+					ApplyBrush(Applying[j], EditTargets[j], Command.X, Command.Y, Center);
+			}
+			EditTargets[i] = Center.TerrainHeight;
+		}
+
+		for (int y = CommandLowY; y < CommandHighY; y++)
+			EditedTiles[(y - 1) / RowsPerTile] |= IsTerrainBrush(Command) ? TERRAIN_EDIT : 1;
+	}
+
+	// A cell only depends on itself and the brushes, so the rows can go in any order, and every cell still gets the brushes in order
+	Pool.ParallelFor(LowY, HighY, [&](int y) {
+		for (size_t i = 0; i < Applying.size(); i++)
+		{
+			int CommandLowX, CommandLowY, CommandHighX, CommandHighY;
+			GetBrushBounds(Applying[i], SizeX, SizeY, CommandLowX, CommandLowY, CommandHighX, CommandHighY);
+			if (y < CommandLowY || y >= CommandHighY)
+				continue;
+			for (int x = CommandLowX; x < CommandHighX; x++)
+				ApplyBrush(Applying[i], EditTargets[i], x, y, Cells[x + y * SizeX]);
+		}
+	});
+
+	// Only the tiles a terrain brush edited look for new slopes, every tile only marks around its own rows
+	// The cells a brush changes are all inside its bounds, the ones next to them are marked around those
+	Pool.ParallelFor(0, NumTiles, [&](int Tile) {
+		DirtyTiles[Tile] |= EditedTiles[Tile] != 0;
+		if (!(EditedTiles[Tile] & TERRAIN_EDIT))
+			return;
+		int TileLowY = 1 + Tile * RowsPerTile;
+		int TileHighY = std::min(TileLowY + RowsPerTile, SizeY - 1);
+		for (size_t i = 0; i < Applying.size(); i++)
+		{
+			if (!IsTerrainBrush(Applying[i]))
+				continue;
+			int CommandLowX, CommandLowY, CommandHighX, CommandHighY;
+			GetBrushBounds(Applying[i], SizeX, SizeY, CommandLowX, CommandLowY, CommandHighX, CommandHighY);
+			SeedUnstable(CommandLowX, std::max(CommandLowY, TileLowY), CommandHighX, std::min(CommandHighY, TileHighY));
+		}
+	});
+	Applying.clear();
+}
+
+void World2D::MarkTerrainChanged(int StartX, int StartY, int EndX, int EndY)
+{
+	for (int y = std::max(StartY, 1); y < std::min(EndY, SizeY - 1); y++)
+		DirtyTiles[(y - 1) / RowsPerTile] = 1;
+	SeedUnstable(StartX, StartY, EndX, EndY);
+}
+
+// Safe from more than one thread, the marks are atomic
+void World2D::SeedUnstable(int StartX, int StartY, int EndX, int EndY)
+{
+	bool Wrap = SeedBoundary == BoundaryPolicy::Periodic;
+	for (int y = std::max(StartY, 1); y < std::min(EndY, SizeY - 1); y++)
+		for (int x = std::max(StartX, 1); x < std::min(EndX, SizeX - 1); x++)
+			MarkAround(StepCount & 1, x, y, Wrap);
+}
+
+void World2D::MarkAllUnstable()
+{
+	std::fill(DirtyTiles.get(), DirtyTiles.get() + NumTiles, 1);
+	for (int y = 1; y < SizeY - 1; y++)
+	{
+		for (int x = 1; x < SizeX - 1; x++)
+			Unstable[StepCount & 1][x + y * SizeX].store(1, std::memory_order_relaxed);
+		UnstableRows[StepCount & 1][y].store(1, std::memory_order_relaxed);
+	}
+}
+
+bool World2D::IsRowDirty(int y) const { return DirtyTiles[std::min(std::max(y - 1, 0), SizeY - 3) / RowsPerTile]; }
+void World2D::ClearDirtyTiles() { std::fill(DirtyTiles.get(), DirtyTiles.get() + NumTiles, 0); }
+
+void World2D::SetRainMap(const float* Map) { Rain.SetMap(Map); }
+void World2D::ClearSprings() { Rain.ClearSprings(); }
+bool World2D::HasRainMapOrSprings() const { return !Rain.IsUniform(); }
+
+bool World2D::AddSpring(int X, int Y, float Rate)
+{
+	RainSpring Spring;
+	Spring.X = X;
+	Spring.Y = Y;
+	Spring.Rate = Rate;
+	return Rain.AddSpring(Spring);
+}
+
+int World2D::GetNumThreads() const { return Pool.GetNumThreads(); }
+int World2D::GetRowsPerTile() const { return RowsPerTile; }
+int World2D::GetNumTiles() const { return NumTiles; }
+
+// The outer ring of the grid are ghost cells, they are never simulated, they only give the interior something to look at
+// Every row fills its own left and right ghosts, the first and last row also fill the ghost row next to them
+// For Closed and Open the ghost is a mirror of the terrain next to it, so nothing slumps into or out of the edge
+// Returns if it looks different now, for the dirty tiles
+static bool FillGhostCell(const SimulationVariables& Variables, Cell2D& Ghost, const Cell2D& Inside, const Cell2D& Opposite)
+{
+	float TerrainHeight = Ghost.TerrainHeight;
+	float WaterHeight = Ghost.WaterHeight;
+	float Sediment = Ghost.Sediment;
+	if (Variables.Boundary == BoundaryPolicy::Periodic)
+	{
+		Ghost.TerrainHeight = Opposite.TerrainHeight;
+		Ghost.WaterHeight = Opposite.WaterHeight;
+		Ghost.Sediment = Opposite.Sediment;
+	}
+	else
+	{
+		Ghost.TerrainHeight = Inside.TerrainHeight;
+		Ghost.WaterHeight = Variables.Boundary == BoundaryPolicy::Closed ? Inside.WaterHeight : 0;
+		Ghost.Sediment = Variables.Boundary == BoundaryPolicy::Closed ? Inside.Sediment : 0;
+		Ghost.Left.FlowVolume = 0;
+		Ghost.Right.FlowVolume = 0;
+		Ghost.Up.FlowVolume = 0;
+		Ghost.Down.FlowVolume = 0;
+	}
+	return Ghost.TerrainHeight != TerrainHeight || Ghost.WaterHeight != WaterHeight || Ghost.Sediment != Sediment;
+}
+
+static bool FillGhostRow(const SimulationVariables& Variables, Cell2D* Ptr, int SizeX, int SizeY, int y)
+{
+	int Row = y * SizeX;
+	bool Changed = FillGhostCell(Variables, Ptr[Row], Ptr[Row + 1], Ptr[Row + SizeX - 2]);
+	Changed |= FillGhostCell(Variables, Ptr[Row + SizeX - 1], Ptr[Row + SizeX - 2], Ptr[Row + 1]);
+
+	// Corners only matter for the diagonals of UpdateSteepness, so they are done with the ghost rows
+	auto FillRow = [&](int GhostY, int OppositeY) {
+		for (int x = 0; x < SizeX; x++)
+		{
+			int InsideX = std::min(std::max(x, 1), SizeX - 2);
+			int OppositeX = x == 0 ? SizeX - 2 : (x == SizeX - 1 ? 1 : x);
+			Changed |= FillGhostCell(Variables, Ptr[x + GhostY * SizeX], Ptr[InsideX + Row], Ptr[OppositeX + OppositeY * SizeX]);
+		}
+	};
+
+	if (y == 1)
+		FillRow(0, SizeY - 2);
+	if (y == SizeY - 2)
+		FillRow(SizeY - 1, 1);
+	return Changed;
+}
+
+// After the pipes of a row are done, Closed stops the flow into the ghosts, Periodic hands it to the ghosts on the other side
+// Open does nothing, whatever flows into a ghost is gone
+static void FinishGhostRow(const SimulationVariables& Variables, Cell2D* Ptr, int SizeX, int SizeY, int y)
+{
+	int Row = y * SizeX;
+	Cell2D& First = Ptr[Row + 1];
+	Cell2D& Last = Ptr[Row + SizeX - 2];
+
+	if (Variables.Boundary == BoundaryPolicy::Closed)
+	{
+		First.Left.FlowVolume = 0;
+		Last.Right.FlowVolume = 0;
+		if (y == 1)
+			for (int x = 1; x < SizeX - 1; x++)
+				Ptr[x + Row].Up.FlowVolume = 0;
+		if (y == SizeY - 2)
+			for (int x = 1; x < SizeX - 1; x++)
+				Ptr[x + Row].Down.FlowVolume = 0;
+	}
+	else if (Variables.Boundary == BoundaryPolicy::Periodic)
+	{
+		Ptr[Row].Right = Last.Right;
+		Ptr[Row + SizeX - 1].Left = First.Left;
+		if (y == 1)
+			for (int x = 1; x < SizeX - 1; x++)
+				Ptr[x + (SizeY - 1) * SizeX].Up = Ptr[x + Row].Up;
+		if (y == SizeY - 2)
+			for (int x = 1; x < SizeX - 1; x++)
+				Ptr[x].Down = Ptr[x + Row].Down;
+	}
+}
+
+void World2D::FinishRow(const SimulationVariables& Variables, int Step, int y, const CellUpdate* Update, Diagnostics& TileStat)
+{
+	Cell2D* Ptr = Cells;
+	int RowStart = 1 + y * SizeX;
+	int RowEnd = SizeX - 1 + y * SizeX;
+	int Next = (Step + 1) & 1;
+	bool Wrap = Variables.Boundary == BoundaryPolicy::Periodic;
+
+	// The rain is for the next step, raining before the pipes would change heights the neighbouring tiles are still reading
+	// Only the cells it falls on come out of Drops, the rest only compare their x
+	RainRow Drops(Rain, Variables, Step + 1, y);
+	bool Rains = Step + 1 < EndStep;
+	bool Changed = false;
+	for (int i = RowStart, x = 1; i < RowEnd; i++, x++)
+	{
+		float TerrainHeight = Ptr[i].TerrainHeight;
+		float WaterHeight = Ptr[i].WaterHeight;
+		float Sediment = Ptr[i].Sediment;
+		Ptr[i].FinishWaterSurfaceAndSediment(Update[i - RowStart]);
+		Ptr[i].UpdateErosionAndDeposition(Variables);
+		Ptr[i].UpdateEvaporation(Variables);
+		for (; Rains && Drops.X == x; Drops.Next())
+			Ptr[i].WaterHeight += Drops.Height;
+		if (Variables.Transport != SedimentTransport::Flux)
+			OldSediment[i] = Ptr[i].Sediment;
+		TileStat.Add(Ptr[i], Ptr[i].Cell2D::GetVelocityMagnitude(), i);
+
+		// Slumping, erosion or deposition, any of them can make this or the cells next to it too steep
+		if (Ptr[i].TerrainHeight != TerrainHeight)
+			MarkAround(Next, x, y, Wrap);
+		Changed |= Ptr[i].TerrainHeight != TerrainHeight || Ptr[i].WaterHeight != WaterHeight || Ptr[i].Sediment != Sediment;
+	}
+	if (Changed)
+		DirtyTiles[(y - 1) / RowsPerTile] = 1;
+}
+
+// The same as FinishRow does, for the first step of UpdateCells, the step before it left its rain out
+// Returns if any fell
+bool World2D::AddRain(const SimulationVariables& Variables, long Step, int y)
+{
+	Cell2D* Row = Cells + y * SizeX;
+	RainRow Drops(Rain, Variables, Step, y);
+	bool Rained = Drops.X < SizeX - 1;
+	for (; Drops.X < SizeX - 1; Drops.Next())
+		Row[Drops.X].WaterHeight += Drops.Height;
+	return Rained;
+}
+
+// Pipes phase, the sediment of row y traced back along the velocity of the last step, the pipes of this one aren't the flow yet
+void World2D::AdvectRow(const SimulationVariables& Variables, int Tile, int y)
+{
+	float* DisplacementX = TraceScratch.get() + Tile * 3 * SizeX;
+	float* DisplacementY = DisplacementX + SizeX;
+
+	// A positive VelocityY flows to the row above
+	for (int x = 1; x < SizeX - 1; x++)
+	{
+		const Cell2D& Curr = Cells[x + y * SizeX];
+		DisplacementX[x] = Advection::GetDisplacement(Variables, Curr.Velocity.first, Curr.GetLiquidHeight());
+		DisplacementY[x] = -Advection::GetDisplacement(Variables, Curr.Velocity.second, Curr.GetLiquidHeight());
+	}
+
+	int Row = y * SizeX;
+	bool Correct = Variables.Transport == SedimentTransport::MacCormack;
+	Advection(Variables, OldSediment.get(), SizeX, SizeY).TraceRow(y, DisplacementX, DisplacementY, Advected.get() + Row,
+		Correct ? AdvectedMin.get() + Row : nullptr, Correct ? AdvectedMax.get() + Row : nullptr);
+}
+
+// Surface phase, before the velocity of row y is replaced, the rows of the other tiles it reads were traced in their pipes phase
+// Returns the corrected sediment of the row, in the scratch of the tile
+const float* World2D::CorrectRow(const SimulationVariables& Variables, int Tile, int y)
+{
+	float* DisplacementX = TraceScratch.get() + Tile * 3 * SizeX;
+	float* DisplacementY = DisplacementX + SizeX;
+	float* Corrected = DisplacementY + SizeX;
+
+	for (int x = 1; x < SizeX - 1; x++)
+	{
+		const Cell2D& Curr = Cells[x + y * SizeX];
+		DisplacementX[x] = -Advection::GetDisplacement(Variables, Curr.Velocity.first, Curr.GetLiquidHeight());
+		DisplacementY[x] = Advection::GetDisplacement(Variables, Curr.Velocity.second, Curr.GetLiquidHeight());
+	}
+
+	Advection(Variables, Advected.get(), SizeX, SizeY).TraceRow(y, DisplacementX, DisplacementY, Corrected, nullptr, nullptr);
+	for (int i = 1 + y * SizeX, x = 1; x < SizeX - 1; i++, x++)
+		Corrected[x] = Advection::Correct(OldSediment[i], Advected[i], Corrected[x], AdvectedMin[i], AdvectedMax[i]);
+	return Corrected;
+}
+
+void World2D::RunPhase(const SimulationVariables& Variables, int Step, int Tile, int Phase)
+{
+	// Nothing useful can come out of a grid with NaNs, so once a tile saw one everything left is skipped
+	if (BlownUp.load(std::memory_order_relaxed))
+		return;
+
+	Cell2D* Ptr = Cells;
+	int StartY = 1 + Tile * RowsPerTile;
+	int EndY = std::min(StartY + RowsPerTile, SizeY - 1);
+
+	auto StartTime = Stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+	Diagnostics& TileStat = TileStats[Tile].Stats;
+	if (Phase == 1)
+		TileStat.Reset();
+
+	CellUpdate* FirstRow = Scratch.get() + Tile * 3 * SizeX;
+	CellUpdate* Rows[2] = { FirstRow + SizeX, FirstRow + 2 * SizeX };
+
+	Step += StepCount;
+	std::atomic<uint8_t>* CurrentUnstable = Unstable[Step & 1].get();
+	std::atomic<uint8_t>* NextUnstable = Unstable[(Step + 1) & 1].get();
+
+	for (int y = StartY; y < EndY; y++)
+	{
+		int RowStart = 1 + y * SizeX;
+		int RowEnd = SizeX - 1 + y * SizeX;
+
+		if (Phase == 0)
+		{
+			// The ghosts are filled by the rows next to them, so the boundary needs no extra pass
+			if (FillGhostRow(Variables, Ptr, SizeX, SizeY, y))
+				DirtyTiles[Tile] = 1;
+			for (int i = RowStart; i < RowEnd; i++)
+				Ptr[i].UpdatePipes(Variables, Ptr[i - 1], Ptr[i + 1], Ptr[i - SizeX], Ptr[i + SizeX]);
+			FinishGhostRow(Variables, Ptr, SizeX, SizeY, y);
+			if (Variables.Transport != SedimentTransport::Flux)
+				AdvectRow(Variables, Tile, y);
+		}
+		else if (Phase == 1)
+		{
+			CellUpdate* Update = y == StartY ? FirstRow : Rows[y & 1];
+			const float* Sediment = nullptr;
+			if (Variables.Transport == SedimentTransport::SemiLagrangian)
+				Sediment = Advected.get() + y * SizeX;
+			else if (Variables.Transport == SedimentTransport::MacCormack)
+				Sediment = CorrectRow(Variables, Tile, y);
+
+			for (int i = RowStart; i < RowEnd; i++)
+			{
+				Ptr[i].UpdateWaterSurfaceAndSediment(Variables, Ptr[i - 1], Ptr[i + 1], Ptr[i - SizeX], Ptr[i + SizeX], Update[i - RowStart]);
+				Update[i - RowStart].TerrainHeight = Ptr[i].TerrainHeight;
+			}
+			if (Sediment)
+				for (int x = 1; x < SizeX - 1; x++)
+					Update[x - 1].Sediment = Sediment[x];
+
+			// Still too steep cells mark themselves, if they slump they (and the cells next to them) are marked by FinishRow anyway
+			// Nobody else writes to this set of these rows while this runs, so no exchange needed
+			if (UnstableRows[Step & 1][y].load(std::memory_order_relaxed))
+			{
+				UnstableRows[Step & 1][y].store(0, std::memory_order_relaxed);
+				for (int i = RowStart; i < RowEnd; i++)
+				{
+					if (!CurrentUnstable[i].load(std::memory_order_relaxed))
+						continue;
+					CurrentUnstable[i].store(0, std::memory_order_relaxed);
+					if (Ptr[i].UpdateSteepness(Variables, Ptr[i - 1], Ptr[i + 1], Ptr[i - SizeX], Ptr[i + SizeX], Ptr[i - 1 - SizeX], Ptr[i + 1 - SizeX], Ptr[i - 1 + SizeX], Ptr[i + 1 + SizeX], Update[i - RowStart]))
+					{
+						NextUnstable[i].store(1, std::memory_order_relaxed);
+						UnstableRows[(Step + 1) & 1][y].store(1, std::memory_order_relaxed);
+						TileStat.SteepCells++;
+					}
+				}
+			}
+
+			// Nothing reads the row above anymore, unless its the first row, the tile above can still be reading that one
+			if (y - 1 > StartY)
+				FinishRow(Variables, Step, y - 1, Rows[(y - 1) & 1], TileStat);
+		}
+	}
+
+	// The last row waits in the scratch as well, for the tile below
+	if (Phase == 2)
+	{
+		FinishRow(Variables, Step, StartY, FirstRow, TileStat);
+		if (EndY - 1 > StartY)
+			FinishRow(Variables, Step, EndY - 1, Rows[(EndY - 1) & 1], TileStat);
+	}
+
+	if (Phase == NumPhases - 1 && TileStat.IsBlownUp())
+		BlownUp = true;
+
+	if (!Stats)
+		return;
+
+	// Only this tile writes to its counters, relaxed is enough, Render doesn't need them to line up
+	Metrics::TileCounters& Counters = Stats->GetTile(Tile);
+	uint64_t Nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - StartTime).count();
+	Counters.PhaseNanoseconds[Phase].fetch_add(Nanoseconds, std::memory_order_relaxed);
+	Counters.PhaseRuns[Phase].fetch_add(1, std::memory_order_relaxed);
+	if (Phase == NumPhases - 1)
+	{
+		Counters.WaterVolume.store(TileStat.Water.Sum, std::memory_order_relaxed);
+		Counters.SedimentVolume.store(TileStat.Sediment.Sum, std::memory_order_relaxed);
+		Counters.TerrainVolume.store(TileStat.Terrain.Sum, std::memory_order_relaxed);
+		Counters.ActiveCells.store(TileStat.WetCells, std::memory_order_relaxed);
+		Counters.Cells.fetch_add((uint64_t)(EndY - StartY) * (SizeX - 2), std::memory_order_relaxed);
+		Counters.Steps.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+// The unstable cells depend on MAX_STEP, the distances and what the ghosts are, so when any of them changes everything is checked again
+// The sediment to trace back into is taken again every time, the cells can be changed from outside between calls
+void World2D::Prepare(const SimulationVariables& Variables, int Steps)
+{
+	EndStep = StepCount + Steps;
+	if (Steps > 0)
+		Pool.ParallelFor(0, NumTiles, [&](int Tile) {
+			for (int y = 1 + Tile * RowsPerTile; y < std::min(1 + (Tile + 1) * RowsPerTile, SizeY - 1); y++)
+				if (AddRain(Variables, StepCount, y))
+					DirtyTiles[Tile] = 1;
+		});
+
+	if (Variables.Transport != SedimentTransport::Flux)
+	{
+		// The ghosts stay 0, what flows in over an Open edge
+		if (!OldSediment)
+		{
+			OldSediment.reset(new float[SizeX * SizeY]());
+			Advected.reset(new float[SizeX * SizeY]());
+			AdvectedMin.reset(new float[SizeX * SizeY]());
+			AdvectedMax.reset(new float[SizeX * SizeY]());
+			TraceScratch.reset(new float[NumTiles * 3 * SizeX]());
+		}
+		for (int y = 1; y < SizeY - 1; y++)
+			for (int x = 1; x < SizeX - 1; x++)
+				OldSediment[x + y * SizeX] = Cells[x + y * SizeX].Sediment;
+	}
+
+	if (Variables.MAX_STEP != SeedMaxStep || Variables.PIPE_LENGTH != SeedPipeLength || Variables.Boundary != SeedBoundary)
+	{
+		SeedMaxStep = Variables.MAX_STEP;
+		SeedPipeLength = Variables.PIPE_LENGTH;
+		SeedBoundary = Variables.Boundary;
+		MarkAllUnstable();
+	}
+}
+
+bool World2D::UpdateCells(const SimulationVariables& Variables, int Steps)
+{
+	ApplyEdits();
+	Prepare(Variables, Steps);
+
+	// With Periodic the first and last tile read each others rows
+	bool Wraps = Variables.Boundary == BoundaryPolicy::Periodic;
+	if (Wraps != GraphWraps)
+	{
+		GraphWraps = Wraps;
+		Graph.Setup(NumTiles, NumPhases, GraphWraps);
+	}
+
+	Graph.Run(Pool, Steps, [&](int Step, int Tile, int Phase) { RunPhase(Variables, Step, Tile, Phase); });
+	StepCount += Steps;
+	return !BlownUp;
+}
+
+bool World2D::UpdateCellsBarrier(const SimulationVariables& Variables, int Steps)
+{
+	ApplyEdits();
+	Prepare(Variables, Steps);
+
+	Graph.RunBarrier(Pool, Steps, [&](int Step, int Tile, int Phase) { RunPhase(Variables, Step, Tile, Phase); });
+	StepCount += Steps;
+	return !BlownUp;
+}
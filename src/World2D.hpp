@@ -0,0 +1,162 @@
+#ifndef WORLD2D_HPP
+#define WORLD2D_HPP
+
+#include "SimulationVariables.hpp"
+#include "Cell2D.hpp"
+#include "ThreadPool.hpp"
+#include "TileGraph.hpp"
+#include "Metrics.hpp"
+#include "Diagnostics.hpp"
+#include "LakeSolver.hpp"
+#include "Brush.hpp"
+#include "Rainfall.hpp"
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Steps a grid of Cell2D, the outer ring are ghost cells (see Variables.Boundary)
+// The interior is split in tiles of RowsPerTile rows, every step is 3 phases per tile:
+//	Pipes:		fill the ghosts, UpdatePipes, and the boundary for the pipes
+//	Surface:	UpdateWaterSurfaceAndSediment and UpdateSteepness, and the finish (below) of every row but the first and the last
+//	Finish:		FinishWaterSurfaceAndSediment, erosion, evaporation and the rain for the next step, of the first and the last row
+//				(the first step of UpdateCells gets its rain from Prepare, and the last one leaves it to the next call,
+//				so every step starts with its rain, and after a call the cells have the rain of as many steps as it ran)
+// A phase of a tile only reads its own rows and the row next to it in the neighbouring tiles
+// The new heights of a row can be written as soon as the rows next to it are done reading the old ones,
+// inside a tile thats right after the row below it is done, so only the rows next to other tiles have to wait for the finish phase
+// The finish also fills the Diagnostics of its tile, as soon as one has a NaN or negative cell, the rest of the phases are skipped
+// Only cells that might be steeper than MAX_STEP go through UpdateSteepness, a cell is marked when it, or a cell next to it,
+// got a new terrain height, and stays marked for as long as it is too steep, flat terrain costs nothing
+// With a semi-Lagrangian Variables.Transport the pipes phase also traces the sediment of its rows back (see Advection),
+// into a copy of the sediment that only the finish writes to, and the surface uses what that gave instead of the flux
+// MacCormack traces it back the other way in the surface phase, from the rows the tiles next to it traced
+// A trace never goes further than the next row, so it stays inside the tiles next to it, whatever RowsPerTile is
+// The rain only depends on the step and the row (see RainSource), so the same steps always give the same cells, whatever the threads
+// Brushes only go into a queue, the cells are only changed before the first step of UpdateCells, never while one runs
+// Every tile knows if any of its cells (or the ghosts next to them) changed, so a draw only has to do the rows of those again
+class World2D {
+	public:
+		Cell2D* Cells;
+		const int SizeX;
+		const int SizeY;
+
+		World2D(Cell2D* Cells, int SizeX, int SizeY, int NumThreads = 0, int RowsPerTile = 8);
+		World2D(const World2D& From) = delete;
+
+		~World2D();
+
+		World2D& operator = (const World2D& From) = delete;
+
+		// Tiles go through the steps as a wavefront, no barriers
+		// Applies the queued brushes first
+		// Returns false if the grid blew up, it stays stopped until ClearBlowUp
+		bool UpdateCells(const SimulationVariables& Variables, int Steps = 1);
+		// Every phase is a barrier over all tiles, same result
+		bool UpdateCellsBarrier(const SimulationVariables& Variables, int Steps = 1);
+
+		// Of the interior after the last step
+		Diagnostics GetDiagnostics() const;
+		bool IsBlownUp() const;
+		void ClearBlowUp();
+
+		// Moves the water to where it would settle after a long time, and carries on from there with the next UpdateCells
+		// Applies the queued brushes first
+		// Returns the volume that drained over an Open edge
+		double FillLakes(const SimulationVariables& Variables);
+
+		// Can be called from any thread, also while a step runs, the brushes are applied in the order they were queued
+		void QueueBrush(const BrushCommand& Command);
+		// All the rows the queued brushes touch, in parallel, UpdateCells and FillLakes call it, only call it between steps
+		void ApplyEdits();
+
+		// The terrain was changed from outside, the cells in [Start, End) and the ones next to them get checked for slumping again
+		void MarkTerrainChanged(int StartX, int StartY, int EndX, int EndY);
+		void MarkAllUnstable();
+
+		// If a cell of row y changed since ClearDirtyTiles, in a step, by a brush, FillLakes or MarkTerrainChanged, all of them at first
+		// Its kept per tile, so every row of a tile with a changed cell is dirty, the ghost rows go with the tile next to them
+		bool IsRowDirty(int y) const;
+		void ClearDirtyTiles();
+
+		// Where the rain falls (see RainSource), only call these between steps
+		// Map is SizeX x SizeY, 1 is RAINFALL, nullptr rains the same everywhere again
+		void SetRainMap(const float* Map);
+		// Returns false for a ghost cell or a negative rate
+		bool AddSpring(int X, int Y, float Rate);
+		void ClearSprings();
+		// If there is a map or a spring, the adaptive grid (LODGrid2D) only knows RAINFALL
+		bool HasRainMapOrSprings() const;
+
+		// Counts into Source from now on, nullptr stops counting
+		// Call it again after the terrain was replaced, the conservation drift is relative to this
+		void SetMetrics(Metrics* Source);
+
+		int GetNumThreads() const;
+		int GetRowsPerTile() const;
+		int GetNumTiles() const;
+
+	private:
+		ThreadPool Pool;
+		TileGraph Graph;
+		int RowsPerTile;
+		int NumTiles;
+		bool GraphWraps;
+		Metrics* Stats;
+
+		struct alignas(64) TileDiagnostics
+		{
+			Diagnostics Stats;
+		};
+		std::unique_ptr<TileDiagnostics[]> TileStats;
+		std::atomic_bool BlownUp;
+
+		// 3 rows per tile, the first row of the tile and two to take turns for the rest
+		std::unique_ptr<CellUpdate[]> Scratch;
+
+		// The cells (and rows with any cell) that might be too steep, a step reads the set of its parity and fills the other one
+		// Tiles mark cells in the rows next to them, so these are atomic, relaxed is enough since the graph orders the steps
+		std::unique_ptr<std::atomic<uint8_t>[]> Unstable[2];
+		std::unique_ptr<std::atomic<uint8_t>[]> UnstableRows[2];
+		long StepCount;
+		float SeedMaxStep;
+		float SeedPipeLength;
+		BoundaryPolicy SeedBoundary;
+
+		LakeSolver Lakes;
+		RainSource Rain;
+		long EndStep;	// of the steps UpdateCells is running, the finish of the last one doesn't rain
+
+		// The queue, and what ApplyEdits took out of it, so brushes can be queued while those are applied
+		// Flatten pulls to the height under its center after the brushes before it, thats in Targets
+		std::mutex EditMutex;
+		std::vector<BrushCommand> Edits;
+		std::vector<BrushCommand> Applying;
+		std::vector<float> EditTargets;
+
+		// The tiles the last ApplyEdits changed (TERRAIN_EDIT if the slopes can have changed), and the ones changed since ClearDirtyTiles
+		// Only the phases of a tile write to its own, or the World between steps
+		std::unique_ptr<uint8_t[]> EditedTiles;
+		std::unique_ptr<uint8_t[]> DirtyTiles;
+
+		// The sediment at the end of the last step, what the trace of every cell gave, and for MacCormack the range it came from
+		// 3 rows per tile, the displacements and the correction
+		std::unique_ptr<float[]> OldSediment;
+		std::unique_ptr<float[]> Advected;
+		std::unique_ptr<float[]> AdvectedMin;
+		std::unique_ptr<float[]> AdvectedMax;
+		std::unique_ptr<float[]> TraceScratch;
+
+		static const int NumPhases = 3;
+
+		void Prepare(const SimulationVariables& Variables, int Steps);
+		void RunPhase(const SimulationVariables& Variables, int Step, int Tile, int Phase);
+		void FinishRow(const SimulationVariables& Variables, int Step, int y, const CellUpdate* Update, Diagnostics& TileStat);
+		bool AddRain(const SimulationVariables& Variables, long Step, int y);
+		void SeedUnstable(int StartX, int StartY, int EndX, int EndY);
+		void MarkAround(int Set, int x, int y, bool Wrap);
+		void AdvectRow(const SimulationVariables& Variables, int Tile, int y);
+		const float* CorrectRow(const SimulationVariables& Variables, int Tile, int y);
+};
+
+#endif
@@ -1,5 +1,9 @@
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <vector>
 
 extern "C" {
 	#include "MLX42.h"
@@ -7,6 +11,14 @@ extern "C" {
 
 #include "Cell1D.hpp"
 #include "Cell2D.hpp"
+#include "LODGrid2D.hpp"
+#include "World2D.hpp"
+#include "MetricsServer.hpp"
+#include "Session.hpp"
+#include "Allocations.hpp"
+#include "Golden.hpp"
+#include "FrameExporter.hpp"
+#include "AutoTune.hpp"
 #include "SimulationVariables.hpp"
 
 #include <chrono>
@@ -17,6 +29,7 @@ void DoCell1DTest(const SimulationVariables& Variables)
 	const int SIZE = 128;
 	
 	Cell1D Cells[SIZE];
+	std::vector<float> Scratch(Cell1D::GetScratchSize(SIZE));
 
 	for (int i = 0; i < SIZE; i++)
 	{
@@ -43,7 +56,7 @@ void DoCell1DTest(const SimulationVariables& Variables)
 		Cell1D::DrawCells(Variables, Cells, SIZE, 40, 1.0f);
 
 		for (int i = 0; i < 10; i++)
-			Cell1D::UpdateCells(Variables, Cells, SIZE);
+			Cell1D::UpdateCells(Variables, Cells, SIZE, Scratch.data());
 
 		std::this_thread::sleep_for(std::chrono::milliseconds(100));
 	}
@@ -57,41 +70,23 @@ struct HookData
 
 	SimulationVariables& Variables;
 	Cell2D* Cells;
+	World2D& World;
+	LODGrid2D& LOD;
+	Session& Sim;
+	bool LODKeyDown;
+	bool FillKeyDown;
+	// The range the image was last drawn with, if it stays the same only the rows the World changed are drawn again
+	float DrawnMin;
+	float DrawnMax;
 
 	const int SIZEX;
 	const int SIZEY;
 	const int ZOOM_SIZE;
 	const int ZOOM_SCALE;
 
-	HookData(mlx_t* mlx, mlx_image_t *img, mlx_image_t *zoom_img, SimulationVariables& Variables, Cell2D* Cells, int SIZEX, const int SIZEY, int ZOOM_SIZE, int ZOOM_SCALE) : mlx(mlx), img(img), zoom_img(zoom_img), Variables(Variables), Cells(Cells), SIZEX(SIZEX), SIZEY(SIZEY), ZOOM_SIZE(ZOOM_SIZE), ZOOM_SCALE(ZOOM_SCALE) { }
+	HookData(mlx_t* mlx, mlx_image_t *img, mlx_image_t *zoom_img, SimulationVariables& Variables, Cell2D* Cells, World2D& World, LODGrid2D& LOD, Session& Sim, int SIZEX, const int SIZEY, int ZOOM_SIZE, int ZOOM_SCALE) : mlx(mlx), img(img), zoom_img(zoom_img), Variables(Variables), Cells(Cells), World(World), LOD(LOD), Sim(Sim), LODKeyDown(false), FillKeyDown(false), DrawnMin(0), DrawnMax(0), SIZEX(SIZEX), SIZEY(SIZEY), ZOOM_SIZE(ZOOM_SIZE), ZOOM_SCALE(ZOOM_SCALE) { }
 };
 
-template<class T>
-void Apply(Cell2D* Cells, int SizeX, int SizeY, int x, int y, int Range, T ApplyFunc)
-{
-	int LowX = std::max(x - Range, 1);
-	int HighX = std::min(x + Range, SizeX - 1);
-	int LowY = std::max(y - Range, 1);
-	int HighY = std::min(y + Range, SizeY - 1);
-
-	float MaxSqrDist = Range * Range;
-
-	for (int ix = LowX; ix < HighX; ix++)
-		for (int iy = LowY; iy < HighY; iy++)
-		{
-			float OX = ix - x;
-			float OY = iy - y;
-
-			float SqrDist = OX * OX + OY * OY;
-
-			float Strength = 1 - (SqrDist / MaxSqrDist);
-			if (Strength < 0)
-				continue;
-
-			ApplyFunc(Cells[ix + iy * SizeX], Strength);
-		}
-}
-
 static void	hook(void *param)
 {
 	HookData	*data = (HookData*)param;
@@ -99,62 +94,102 @@ static void	hook(void *param)
 	if (mlx_is_key_down(data->mlx, MLX_KEY_ESCAPE))
 		mlx_close_window(data->mlx);
 	
+	// Everything that changes the sim goes through the Session, so it can be recorded
+	Session& Sim = data->Sim;
 	if (mlx_is_key_down(data->mlx, MLX_KEY_DOWN))
-		data->Variables.RAINFALL /= 1.1f;
+		Sim.SetRainfall(data->Variables.RAINFALL / 1.1f);
 	if (mlx_is_key_down(data->mlx, MLX_KEY_UP))
-	{
-		if (data->Variables.RAINFALL <= 0)
-			data->Variables.RAINFALL = 0.0000001f;
-		data->Variables.RAINFALL *= 1.1f;
-	}
+		Sim.SetRainfall((data->Variables.RAINFALL <= 0 ? 0.0000001f : data->Variables.RAINFALL) * 1.1f);
 
 	if (mlx_is_key_down(data->mlx, MLX_KEY_E))
-		data->Variables.MAX_STEP /= 1.1f;
+		Sim.SetMaxStep(data->Variables.MAX_STEP / 1.1f);
 	if (mlx_is_key_down(data->mlx, MLX_KEY_D))
+		Sim.SetMaxStep((data->Variables.MAX_STEP <= 0 ? 0.0000001f : data->Variables.MAX_STEP) * 1.1f);
+
+	// L toggles the adaptive grid, only on the press, not every frame its held
+	bool LODKeyDown = mlx_is_key_down(data->mlx, MLX_KEY_L);
+	if (LODKeyDown && !data->LODKeyDown)
 	{
-		if (data->Variables.MAX_STEP <= 0)
-			data->Variables.MAX_STEP = 0.0000001f;
-		data->Variables.MAX_STEP *= 1.1f;
+		Sim.ToggleLOD();
+		if (Sim.IsUsingLOD())
+		{
+			std::cout << "LOD: " << data->LOD.GetNodeCount() << " nodes for " << data->LOD.GetFineCellCount() << " cells" << std::endl;
+			if (data->World.HasRainMapOrSprings())
+				std::cout << "LOD: the rain map and the springs are ignored, every node gets the same rain" << std::endl;
+		}
+		else
+			std::cout << "LOD: off" << std::endl;
 	}
+	data->LODKeyDown = LODKeyDown;
+
+	// F jumps the water to where it would settle, so a scenario doesn't need thousands of steps to fill its lakes
+	bool FillKeyDown = mlx_is_key_down(data->mlx, MLX_KEY_F);
+	if (FillKeyDown && !data->FillKeyDown && !Sim.IsUsingLOD())
+	{
+		auto StartTime = std::chrono::steady_clock::now();
+		double Drained = Sim.FillLakes();
+		std::chrono::duration<double, std::milli> Elapsed = std::chrono::steady_clock::now() - StartTime;
+		std::cout << "Filled the lakes in " << Elapsed.count() << " ms, " << Drained << " drained over the edge" << std::endl;
+	}
+	data->FillKeyDown = FillKeyDown;
 
 	int32_t x, y;
 	mlx_get_mouse_pos(data->mlx, &x, &y);
 	if (x >= 0 && y >= 0 && x < data->SIZEX && y < data->SIZEY)
 	{
-		float StrengthMult = 1;
-		if (mlx_is_key_down(data->mlx, MLX_KEY_LEFT_SHIFT))
-			StrengthMult *= 5;
-
-		int Range = 5;
+		BrushCommand Stroke;
+		Stroke.X = x;
+		Stroke.Y = y;
+		Stroke.Strength = mlx_is_key_down(data->mlx, MLX_KEY_LEFT_SHIFT) ? 5 : 1;
+		Stroke.Add = mlx_is_mouse_down(data->mlx, MLX_MOUSE_BUTTON_LEFT);
+		Stroke.Remove = mlx_is_mouse_down(data->mlx, MLX_MOUSE_BUTTON_RIGHT);
+
+		Stroke.Range = 5;
 		for (keys_t Curr = MLX_KEY_1; Curr <= MLX_KEY_9; Curr = (keys_t)(((int)Curr) + 1))
 			if (mlx_is_key_down(data->mlx, Curr))
-				Range *= (Curr - MLX_KEY_1) + 2;
-
-
-		if (mlx_is_key_down(data->mlx, MLX_KEY_Q)) {
-			float TargetHeight = data->Cells[x + y * data->SIZEX].TerrainHeight;
-
-			Apply(data->Cells, data->SIZEX, data->SIZEY, x, y, Range, [&](Cell2D& Cell, float Strength) { Cell.TerrainHeight += (TargetHeight - Cell.TerrainHeight) * Strength; });
-		} else if (mlx_is_key_down(data->mlx, MLX_KEY_SPACE)) {
-			if (mlx_is_mouse_down(data->mlx, MLX_MOUSE_BUTTON_LEFT))
-				Apply(data->Cells, data->SIZEX, data->SIZEY, x, y, Range, [&](Cell2D& Cell, float Strength) { Cell.TerrainHeight += Strength / 5 * StrengthMult; });
-			if (mlx_is_mouse_down(data->mlx, MLX_MOUSE_BUTTON_RIGHT))
-				Apply(data->Cells, data->SIZEX, data->SIZEY, x, y, Range, [&](Cell2D& Cell, float Strength) { Cell.TerrainHeight -= Strength / 5 * StrengthMult; });
-		} else if (mlx_is_key_down(data->mlx, MLX_KEY_W)) {
-			if (mlx_is_mouse_down(data->mlx, MLX_MOUSE_BUTTON_LEFT))
-				Apply(data->Cells, data->SIZEX, data->SIZEY, x, y, Range, [&](Cell2D& Cell, float Strength) { Cell.Sediment += Strength / 5 * StrengthMult; });
-			if (mlx_is_mouse_down(data->mlx, MLX_MOUSE_BUTTON_RIGHT))
-				Apply(data->Cells, data->SIZEX, data->SIZEY, x, y, Range, [&](Cell2D& Cell, float Strength) { Cell.Sediment *= 1 - Strength; });
-		} else {
-			if (mlx_is_mouse_down(data->mlx, MLX_MOUSE_BUTTON_LEFT))
-				Apply(data->Cells, data->SIZEX, data->SIZEY, x, y, Range, [&](Cell2D& Cell, float Strength) { Cell.WaterHeight += Strength / 5 * StrengthMult; });
-			if (mlx_is_mouse_down(data->mlx, MLX_MOUSE_BUTTON_RIGHT))
-				Apply(data->Cells, data->SIZEX, data->SIZEY, x, y, Range, [&](Cell2D& Cell, float Strength) { Cell.WaterHeight *= 1 - Strength; });
-		}
+				Stroke.Range *= (Curr - MLX_KEY_1) + 2;
+
+		if (mlx_is_key_down(data->mlx, MLX_KEY_Q))
+			Stroke.Tool = BrushTool::Flatten;
+		else if (mlx_is_key_down(data->mlx, MLX_KEY_SPACE))
+			Stroke.Tool = BrushTool::Terrain;
+		else if (mlx_is_key_down(data->mlx, MLX_KEY_W))
+			Stroke.Tool = BrushTool::Sediment;
+		else
+			Stroke.Tool = BrushTool::Water;
+
+		if (Stroke.Tool == BrushTool::Flatten || Stroke.Add || Stroke.Remove)
+			Sim.Brush(Stroke);
 	}
 
-	Cell2D::UpdateCells(data->Variables, data->Cells, data->SIZEX, data->SIZEY);
-	Cell2D::DrawImage(data->Variables, data->img, data->Cells, data->SIZEX, data->SIZEY, 0, -10);
+	if (!Sim.Step())
+		std::cout << "Blew up, stopped" << std::endl << data->World.GetDiagnostics();
+	Sim.Sync();
+
+	// The solver already knows the terrain range, only the adaptive grid needs the draw to look for it
+	// The World knows which tiles changed, so when the range stays the same the rest of the image is still right
+	if (Sim.IsUsingLOD())
+	{
+		Cell2D::DrawImage(data->Variables, data->img, data->Cells, data->SIZEX, data->SIZEY, 0, -10);
+		data->DrawnMin = data->DrawnMax = 0;
+	}
+	else
+	{
+		Diagnostics Stats = data->World.GetDiagnostics();
+		float Min = Stats.MinTerrain;
+		float Max = std::max(Stats.MinTerrain + 10, Stats.MaxTerrain);
+		bool DrawAll = Min != data->DrawnMin || Max != data->DrawnMax;
+		for (int Start = 0, End; Start < data->SIZEY; Start = End)
+		{
+			for (End = Start + 1; End < data->SIZEY && (DrawAll || data->World.IsRowDirty(End) == data->World.IsRowDirty(Start)); End++)
+				;
+			if (DrawAll || data->World.IsRowDirty(Start))
+				Cell2D::DrawRows(data->img, data->Cells, data->SIZEX, Min, Max, Start, End);
+		}
+		data->World.ClearDirtyTiles();
+		data->DrawnMin = Min;
+		data->DrawnMax = Max;
+	}
 
 	if (x >= 0 && y >= 0 && x < data->SIZEX && y < data->SIZEY)
 	{
@@ -172,15 +207,8 @@ static void	hook(void *param)
 	//		mlx_put_pixel(data->img, x, y, rand() % RAND_MAX);
 }
 
-void DoCell2DTest(SimulationVariables& Variables)
+static void MakeTerrain(const SimulationVariables& Variables, Cell2D* Cells, int SIZEX, int SIZEY)
 {
-	const int SIZEX = 256;
-	const int SIZEY = 256;
-	const int ZOOM_SIZE = 32;
-	const int ZOOM_SCALE = 8;
-
-	Cell2D* Cells = new Cell2D[SIZEX * SIZEY];
-
 	float CenterX = SIZEX / 2.0f;
 	float CenterY = SIZEY;//SIZEY / 2.0f;
 
@@ -214,6 +242,46 @@ void DoCell2DTest(SimulationVariables& Variables)
 	for (int x = 0; x < SIZEX; x++)
 		for (int y = 0; y < SIZEY; y++)
 			Cells[x + y * SIZEX].TerrainHeight *= 1 + ((float)rand() / RAND_MAX) / 10;
+}
+
+// FNV-1a of the heights, what a replay prints to compare against the session it replays
+static uint64_t GetCellsHash(const Cell2D* Cells, int Count)
+{
+	uint64_t Hash = 14695981039346656037ull;
+	for (int i = 0; i < Count; i++)
+	{
+		float Heights[3] = { Cells[i].TerrainHeight, Cells[i].WaterHeight, Cells[i].Sediment };
+		const unsigned char* Bytes = reinterpret_cast<const unsigned char*>(Heights);
+		for (size_t b = 0; b < sizeof(Heights); b++)
+			Hash = (Hash ^ Bytes[b]) * 1099511628211ull;
+	}
+	return Hash;
+}
+
+// In the working directory, see AutoTune.hpp
+static const char* const TUNING_PATH = "WaterTest.tuning";
+
+// The threads and tile height for a grid, tuned again with --tune, from the last time it was tuned otherwise, the defaults if it never was
+static WorldTuning GetTuning(const SimulationVariables& Variables, const Cell2D* Cells, int SizeX, int SizeY, bool Retune)
+{
+	WorldTuning Tuning;
+	if (Retune)
+		Tuning = TuneWorld(TUNING_PATH, Variables, Cells, SizeX, SizeY);
+	else if (!LoadTuning(TUNING_PATH, Variables, SizeX, SizeY, Tuning))
+		return Tuning;
+	std::cerr << "Tuned: " << Tuning.NumThreads << " threads, " << Tuning.RowsPerTile << " rows per tile" << std::endl;
+	return Tuning;
+}
+
+void DoCell2DTest(SimulationVariables& Variables, const char* MetricsAddress, const char* RecordPath, bool Retune)
+{
+	const int SIZEX = 256;
+	const int SIZEY = 256;
+	const int ZOOM_SIZE = 32;
+	const int ZOOM_SCALE = 8;
+
+	Cell2D* Cells = new Cell2D[SIZEX * SIZEY];
+	MakeTerrain(Variables, Cells, SIZEX, SIZEY);
 
 	//Cells[SIZEX / 2 + SIZEY / 2 * SIZEX].WaterHeight = 1;
 
@@ -228,18 +296,296 @@ void DoCell2DTest(SimulationVariables& Variables)
 	mlx_image_to_window(mlx, img, 0, 0);
 	mlx_image_to_window(mlx, zoom_img, img->width, 0);
 
-	HookData Data(mlx, img, zoom_img, Variables, Cells, SIZEX, SIZEY, ZOOM_SIZE, ZOOM_SCALE);
+	WorldTuning Tuning = GetTuning(Variables, Cells, SIZEX, SIZEY, Retune);
+	World2D World(Cells, SIZEX, SIZEY, Tuning.NumThreads, Tuning.RowsPerTile);
+	LODGrid2D LOD(Cells, SIZEX, SIZEY, 16, Tuning.NumThreads);
+
+	Metrics Stats;
+	MetricsServer Server(Stats);
+	if (MetricsAddress && Server.Start(MetricsAddress))
+		World.SetMetrics(&Stats);
+
+	Session Sim(Variables, World, LOD);
+	if (RecordPath && !Sim.Record(RecordPath))
+		std::cerr << "Can't record to " << RecordPath << std::endl;
+
+	HookData Data(mlx, img, zoom_img, Variables, Cells, World, LOD, Sim, SIZEX, SIZEY, ZOOM_SIZE, ZOOM_SCALE);
 	mlx_loop_hook(mlx, &hook, &Data);
 	mlx_loop(mlx);
 	mlx_terminate(mlx);
+
+	// ./WaterTest replay of the recording prints the same hash
+	Sim.Sync();
+	std::cout << Sim.GetFrame() << " frames, Hash: " << std::hex << GetCellsHash(Cells, SIZEX * SIZEY) << std::dec << std::endl;
+}
+
+// ./WaterTest bench [Size] [Steps]
+// Steps the 2D test terrain headless, with the barrier and the tile graph scheduler, from 1 to 64 threads
+// The graph lines also have how much faster they are than the barrier with as many threads, thats only worth something on as many cores
+void DoBenchmark(SimulationVariables& Variables, int Size, int Steps, const char* MetricsAddress)
+{
+	const int WARMUP_STEPS = 5;
+
+	Cell2D* Start = new Cell2D[Size * Size];
+	MakeTerrain(Variables, Start, Size, Size);
+
+	Cell2D* Cells = new Cell2D[Size * Size];
+	double BaseStepsPerSecond = 0;
+	double BarrierStepsPerSecond[7] = { };
+
+	Metrics Stats;
+	MetricsServer Server(Stats);
+	bool UseMetrics = MetricsAddress && Server.Start(MetricsAddress);
+
+	unsigned int Cores = std::thread::hardware_concurrency();
+	std::cout << "Grid " << Size << "x" << Size << ", " << Steps << " steps, " << Cores << " hardware threads" << std::endl;
+	if (Cores < 2)
+		std::cout << "One hardware thread, more threads only show the overhead, not the scaling" << std::endl;
+	for (int Barrier = 1; Barrier >= 0; Barrier--)
+		for (int Threads = 1, Index = 0; Threads <= 64; Threads *= 2, Index++)
+		{
+			std::copy(Start, Start + Size * Size, Cells);
+
+			World2D World(Cells, Size, Size, Threads);
+			if (UseMetrics)
+				World.SetMetrics(&Stats);
+			auto Step = [&](int Count) {
+				if (Barrier)
+					World.UpdateCellsBarrier(Variables, Count);
+				else
+					World.UpdateCells(Variables, Count);
+			};
+
+			// The warmup does the allocations that only happen once, after it a step shouldn't allocate at all
+			Step(WARMUP_STEPS);
+			size_t StartAllocations = GetAllocationCount();
+			auto StartTime = std::chrono::steady_clock::now();
+			Step(Steps);
+			std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - StartTime;
+			double AllocationsPerStep = (double)(GetAllocationCount() - StartAllocations) / Steps;
+
+			double StepsPerSecond = Steps / Elapsed.count();
+			if (BaseStepsPerSecond == 0)
+				BaseStepsPerSecond = StepsPerSecond;
+			if (Barrier)
+				BarrierStepsPerSecond[Index] = StepsPerSecond;
+
+			std::cout << (Barrier ? "barrier" : "graph  ") << " threads " << Threads << ": " << StepsPerSecond << " steps/s, "
+				<< StepsPerSecond * (Size - 2) * (Size - 2) / 1000000 << " Mcells/s, x" << StepsPerSecond / BaseStepsPerSecond;
+			if (!Barrier)
+				std::cout << ", x" << StepsPerSecond / BarrierStepsPerSecond[Index] << " of the barrier";
+			std::cout << ", " << AllocationsPerStep << " allocations/step" << std::endl;
+			if (AllocationsPerStep > 0)
+				std::cout << "The step allocates, it shouldn't once its warmed up" << std::endl;
+			if (World.IsBlownUp())
+				std::cout << "Blew up, stopped early" << std::endl << World.GetDiagnostics();
+		}
+
+	delete[] Cells;
+	delete[] Start;
+}
+
+// ./WaterTest replay <log>
+// Runs a session recorded with --record again, headless and as fast as it can, on the same terrain and with the same events at the same frames
+// The hash of the cells at the end is the same one the session printed when its window closed, as long as the solver didn't change
+int DoReplay(SimulationVariables& Variables, const char* Path, bool Retune)
+{
+	SessionLog Log;
+	if (!Log.Load(Path))
+	{
+		std::cerr << "Can't read the session in " << Path << std::endl;
+		return 1;
+	}
+	Variables.DT = Log.DT;
+	Variables.Boundary = Log.Boundary;
+	Variables.Transport = Log.Transport;
+
+	Cell2D* Cells = new Cell2D[Log.SizeX * Log.SizeY];
+	MakeTerrain(Variables, Cells, Log.SizeX, Log.SizeY);
+	WorldTuning Tuning = GetTuning(Variables, Cells, Log.SizeX, Log.SizeY, Retune);
+	World2D World(Cells, Log.SizeX, Log.SizeY, Tuning.NumThreads, Tuning.RowsPerTile);
+	LODGrid2D LOD(Cells, Log.SizeX, Log.SizeY, 16, Tuning.NumThreads);
+	Session Sim(Variables, World, LOD);
+
+	auto StartTime = std::chrono::steady_clock::now();
+	size_t Next = 0;
+	for (long Frame = 0; Frame < Log.Frames; Frame++)
+	{
+		while (Next < Log.Events.size() && Log.Events[Next].Frame == Frame)
+			Sim.Apply(Log.Events[Next++]);
+		if (!Sim.Step())
+			std::cout << "Blew up at frame " << Frame << std::endl;
+	}
+	std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - StartTime;
+
+	// The diagnostics of the World are stale if it ended on the adaptive grid
+	Sim.Sync();
+	Diagnostics Stats;
+	for (int i = 0; i < Log.SizeX * Log.SizeY; i++)
+		Stats.Add(Cells[i], Cells[i].Cell2D::GetVelocityMagnitude(), i);
+
+	std::cout << Log.Frames << " frames, " << Log.Events.size() << " events in " << Elapsed.count() << " s, " << Log.Frames / Elapsed.count() << " frames/s" << std::endl;
+	std::cout << Stats << "Hash: " << std::hex << GetCellsHash(Cells, Log.SizeX * Log.SizeY) << std::dec << std::endl;
+
+	delete[] Cells;
+	return 0;
+}
+
+// ./WaterTest export <path|-|"|command"> [Size] [Steps] [Every]
+// Steps the 2D test terrain headless and writes every Every-th step as a frame, Y4M unless --format rgba
+// A command gets the frames on its stdin, like "|ffmpeg -i - erosion.mp4"
+int DoExport(SimulationVariables& Variables, const char* Path, FrameFormat Format, int Size, int Steps, int Every, bool Retune)
+{
+	Cell2D* Cells = new Cell2D[Size * Size];
+	MakeTerrain(Variables, Cells, Size, Size);
+	WorldTuning Tuning = GetTuning(Variables, Cells, Size, Size, Retune);
+	World2D World(Cells, Size, Size, Tuning.NumThreads, Tuning.RowsPerTile);
+
+	FrameExporter Exporter(Size, Size, Format);
+	if (!Exporter.Open(Path))
+	{
+		std::cerr << "Can't write to " << Path << std::endl;
+		delete[] Cells;
+		return 1;
+	}
+
+	// The terrain range is the same as in the window, the diagnostics only have it after a step
+	std::vector<uint8_t> ChangedRows(Size);
+	auto StartTime = std::chrono::steady_clock::now();
+	int Step = 0;
+	while (Step < Steps && !Exporter.HasFailed())
+	{
+		int Count = std::min(Every, Steps - Step);
+		if (!World.UpdateCells(Variables, Count))
+		{
+			std::cerr << "Blew up at step " << Step << ", stopped" << std::endl << World.GetDiagnostics();
+			break;
+		}
+		Step += Count;
+
+		// Only the rows of the tiles that changed get colored again
+		for (int y = 0; y < Size; y++)
+			ChangedRows[y] = World.IsRowDirty(y);
+		World.ClearDirtyTiles();
+
+		Diagnostics Stats = World.GetDiagnostics();
+		Exporter.Submit(Cells, Stats.MinTerrain, std::max(Stats.MinTerrain + 10, Stats.MaxTerrain), ChangedRows.data());
+	}
+	Exporter.Close();
+	std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now() - StartTime;
+
+	// stdout might be the video
+	std::cerr << Exporter.GetFrameCount() << " frames of " << Step << " steps in " << Elapsed.count() << " s, " << Step / Elapsed.count() << " steps/s, waited "
+		<< Exporter.GetWaitSeconds() << " s (" << Exporter.GetWaitSeconds() / Elapsed.count() * 100 << "%) for the writer" << std::endl;
+	if (Exporter.HasFailed())
+		std::cerr << "Writing to " << Path << " failed, stopped" << std::endl;
+
+	delete[] Cells;
+	return Exporter.HasFailed();
 }
 
-int main()
+// Removes "Name <value>" from the arguments, and returns the value, nullptr if its not there
+static const char* TakeOption(int& argc, char** argv, const char* Name)
+{
+	for (int i = 1; i < argc - 1; i++)
+		if (std::string(argv[i]) == Name)
+		{
+			const char* Value = argv[i + 1];
+			std::copy(argv + i + 2, argv + argc, argv + i);
+			argc -= 2;
+			return Value;
+		}
+	return nullptr;
+}
+
+// Removes Name from the arguments, and returns if it was there
+static bool TakeFlag(int& argc, char** argv, const char* Name)
+{
+	for (int i = 1; i < argc; i++)
+		if (std::string(argv[i]) == Name)
+		{
+			std::copy(argv + i + 1, argv + argc, argv + i);
+			argc -= 1;
+			return true;
+		}
+	return false;
+}
+
+// Any mode takes --metrics <port|unix socket path>, to serve the counters of the World2D in the Prometheus format
+// and --transport <flux|semi-lagrangian|maccormack>, how the sediment moves with the water (see SedimentTransport)
+// The window takes --record <path>, to write what was done in it to a log that replay can run again
+// The window, replay and export take --tune, to find the fastest threads and tile height for the grid first (see AutoTune.hpp),
+// they use what was found for the grid on this CPU from then on
+int main(int argc, char** argv)
 {
 	std::srand(0);
 
 	SimulationVariables Variables;
 
+	const char* MetricsAddress = TakeOption(argc, argv, "--metrics");
+	const char* RecordPath = TakeOption(argc, argv, "--record");
+	bool Retune = TakeFlag(argc, argv, "--tune");
+
+	if (const char* Transport = TakeOption(argc, argv, "--transport"))
+	{
+		std::string Name = Transport;
+		if (Name == "flux")
+			Variables.Transport = SedimentTransport::Flux;
+		else if (Name == "semi-lagrangian")
+			Variables.Transport = SedimentTransport::SemiLagrangian;
+		else if (Name == "maccormack")
+			Variables.Transport = SedimentTransport::MacCormack;
+		else
+		{
+			std::cerr << "Unknown transport: " << Name << std::endl;
+			return 1;
+		}
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "bench")
+	{
+		Variables.DT /= 2;
+		Variables.RAINFALL /= 20;
+		DoBenchmark(Variables, argc > 2 ? std::atoi(argv[2]) : 512, argc > 3 ? std::atoi(argv[3]) : 100, MetricsAddress);
+		return 0;
+	}
+
+	if (argc > 2 && std::string(argv[1]) == "replay")
+		return DoReplay(Variables, argv[2], Retune);
+
+	// The option first, so it can't be taken for the path
+	if (argc > 1 && std::string(argv[1]) == "export")
+	{
+		const char* Format = TakeOption(argc, argv, "--format");
+		if (Format && std::string(Format) != "y4m" && std::string(Format) != "rgba")
+		{
+			std::cerr << "Unknown format: " << Format << std::endl;
+			return 1;
+		}
+		if (argc < 3)
+		{
+			std::cerr << "Usage: " << argv[0] << " export <path> [Size] [Steps] [Every] [--format y4m|rgba]" << std::endl;
+			return 1;
+		}
+		Variables.DT /= 2;
+		Variables.RAINFALL /= 20;
+		return DoExport(Variables, argv[2], Format && std::string(Format) == "rgba" ? FrameFormat::RGBA : FrameFormat::Y4M,
+			argc > 3 ? std::atoi(argv[3]) : 512, argc > 4 ? std::atoi(argv[4]) : 10000, argc > 5 ? std::max(1, std::atoi(argv[5])) : 10, Retune);
+	}
+
+	// ./WaterTest golden record <dir> before changing the solver, ./WaterTest golden check <dir> [--exact] after (see Golden.hpp)
+	// The flag first, so it can't be taken for the directory
+	if (argc > 1 && std::string(argv[1]) == "golden")
+	{
+		bool Exact = TakeFlag(argc, argv, "--exact");
+		if (argc > 3 && std::string(argv[2]) == "record")
+			return RecordGolden(argv[3]) != 0;
+		if (argc > 3 && std::string(argv[2]) == "check")
+			return CheckGolden(argv[3], Exact) != 0;
+		std::cerr << "Usage: " << argv[0] << " golden record|check <dir> [--exact]" << std::endl;
+		return 1;
+	}
+
 	/*
 	std::cout << "MaxStep: " << Variables.MAX_STEP << std::endl;
 	std::cout << "Aka: " << std::atan(Variables.MAX_STEP / Variables.PIPE_LENGTH) << " radians" << std::endl;
@@ -250,5 +596,5 @@ int main()
 
 	Variables.DT /= 2;
 	Variables.RAINFALL /= 20;
-	DoCell2DTest(Variables);
+	DoCell2DTest(Variables, MetricsAddress, RecordPath, Retune);
 }
\ No newline at end of file